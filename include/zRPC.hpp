@@ -28,23 +28,596 @@
 #ifndef _ZRPC_HPP_
 #define _ZRPC_HPP_
 
-#include <CRC.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string_view>
 #include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
 #include <zmq.hpp>
+#include "zRPCCache.hpp"
+#include "zRPCCoroutine.hpp"
 #include "zRPCSupport.hpp"
+#include "zRPCThreadPool.hpp"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-conversion"
 #include <msgpack.hpp>
 #pragma GCC diagnostic pop
 
+#include "zRPCBlob.hpp"
+#include "zRPCCodec.hpp"
+
 namespace zRPC
 {
+/**
+ * @brief Integrity check applied to each payload frame
+ *
+ * The mode is chosen by the sender of a request and recorded in its header;
+ * the receiver verifies with the same mode and replies using it, so each
+ * connection settles on the check its client asked for.
+ */
+enum class Integrity : std::uint8_t
+{
+  /**
+   * @brief No check, for trusted transports such as `inproc://` and `ipc://`
+   */
+  none = 0,
+
+  /**
+   * @brief CRC-32C (Castagnoli), hardware accelerated where available
+   */
+  crc32c = 1,
+
+  /**
+   * @brief xxHash32, a fast non-cryptographic hash
+   */
+  xxhash32 = 2
+};
+
+/**
+ * @class Header zRPC.hpp "zRPC.hpp"
+ *
+ * @brief Defines the fixed-size binary header frame sent ahead of each
+ * MessagePack payload frame.
+ *
+ * The header is encoded little-endian with the following layout:
+ * | Offset | Size | Field      |
+ * | ------ | ---- | ---------- |
+ * | 0      | 1    | version    |
+ * | 1      | 1    | integrity  |
+ * | 2      | 2    | flags      |
+ * | 4      | 4    | checksum   |
+ * | 8      | 8    | request id |
+ * | 16     | 4    | method id  |
+ * | 20     | 4    | budget     |
+ *
+ * Replies carry the identifier of the request they answer, allowing the client
+ * to match replies to requests on a shared connection. Requests carry the time
+ * left before the caller gives up on them, relative rather than absolute so
+ * that the client and server clocks need not agree. The checksum covers the
+ * payload frame and every other field of the header: the payload is checked
+ * first, then the encoded header with that result in place of the checksum,
+ * both with the Integrity mode named in the header. Since the sender names
+ * the mode, a header naming Integrity::none is not checked at all; the check
+ * guards against corruption, not against tampering. The payload may be
+ * followed by the frames of any zRPC::Blob it refers to.
+ */
+struct Header
+{
+  /**
+   * @brief Protocol version written into every header
+   */
+  static constexpr std::uint8_t version = 3;
+
+  /**
+   * @brief Size of the encoded header in bytes
+   */
+  static constexpr std::size_t size = 24;
+
+  /**
+   * @brief Flags describing how the payload is to be handled
+   */
+  enum Flags : std::uint16_t
+  {
+    /**
+     * @brief Payload is an array of (name or method id, arguments) calls,
+     * answered with an array of results
+     */
+    batch = 1U << 0,
+
+    /**
+     * @brief Request is one-way; the server does not send a reply
+     */
+    oneway = 1U << 1,
+
+    /**
+     * @brief Reply to a request naming a method id from a different method
+     * table; the client must describe the server again
+     */
+    stale = 1U << 2,
+
+    /**
+     * @brief Request cancels the earlier request from the same connection
+     * with the same identifier; the payload is empty and there is no reply
+     */
+    cancel = 1U << 3,
+
+    /**
+     * @brief Reply payload is a zRPC::Error rather than a result
+     */
+    error = 1U << 4
+  };
+
+  /**
+   * @brief Combination of Flags values
+   */
+  std::uint16_t m_flags{0};
+
+  /**
+   * @brief Integrity check used to compute the checksum
+   */
+  Integrity m_integrity{Integrity::crc32c};
+
+  /**
+   * @brief Checksum of the payload frame and the other header fields
+   */
+  std::uint32_t m_checksum{0};
+
+  /**
+   * @brief Request identifier, unique per client
+   */
+  std::uint64_t m_id{0};
+
+  /**
+   * @brief Method identifier, or 0 when the payload carries the RPC name
+   */
+  std::uint32_t m_method{0};
+
+  /**
+   * @brief Time in ms the caller waits for the reply, or 0 for no limit
+   */
+  std::uint32_t m_budget{0};
+
+  /**
+   * @brief Encode the header into a new 0MQ message
+   *
+   * @return zmq::message_t Encoded header frame
+   */
+  zmq::message_t encode(void) const;
+
+  /**
+   * @brief Decode the header from a received 0MQ message
+   *
+   * @param[in] msg Received header frame
+   * @return true Header was decoded
+   * @return false Frame is not a header of a supported version
+   */
+  bool decode(const zmq::message_t &msg);
+
+  /**
+   * @brief Compute the checksum of a payload and of this header's other
+   * fields using this header's integrity mode
+   *
+   * @param[in] data Pointer to the payload
+   * @param[in] size Size of the payload in bytes
+   * @return std::uint32_t Checksum of the payload and header
+   */
+  std::uint32_t checksum(const void *data, std::size_t size) const;
+
+  /**
+   * @brief Combine the checksum of a payload alone with this header's other
+   * fields
+   *
+   * @param[in] sum Checksum of the payload, computed with this header's
+   * integrity mode
+   * @return std::uint32_t Checksum of the payload and header
+   */
+  std::uint32_t seal(std::uint32_t sum) const;
+};
+
+namespace support
+{
+/**
+ * @brief Compute the checksum of a buffer with the given integrity mode
+ *
+ * CRC-32C uses the SSE4.2 or ARMv8 CRC instructions when the CPU provides
+ * them, falling back to a slicing-by-8 table otherwise.
+ *
+ * @param[in] mode Integrity check to compute
+ * @param[in] data Pointer to the buffer
+ * @param[in] size Size of the buffer in bytes
+ * @return std::uint32_t Checksum of the buffer, or 0 for Integrity::none
+ */
+std::uint32_t checksum(Integrity mode, const void *data, std::size_t size);
+
+/**
+ * @brief Select the default integrity mode for a transport
+ *
+ * @param[in] uri Zero-MQ URI the connection is made over
+ * @return Integrity Integrity::none for `inproc://` and `ipc://` transports,
+ * otherwise Integrity::crc32c
+ */
+inline Integrity integrity(const std::string &uri)
+{
+  if (uri.rfind("inproc://", 0) == 0 || uri.rfind("ipc://", 0) == 0)
+  {
+    return Integrity::none;
+  }
+  return Integrity::crc32c;
+}
+
+/**
+ * @brief Move the contents of a MessagePack buffer into a new 0MQ message
+ *
+ * Small payloads are copied, leaving the buffer intact for reuse, while large
+ * payloads are handed over to the message without copying, leaving the buffer
+ * empty.
+ *
+ * @param[in] sbuf Buffer holding the packed payload
+ * @return zmq::message_t Message holding the payload
+ */
+inline zmq::message_t message(msgpack::sbuffer &sbuf)
+{
+  const auto size = sbuf.size();
+  if (size <= 4096U)
+  {
+    return zmq::message_t(sbuf.data(), size);
+  }
+  return zmq::message_t(
+      sbuf.release(), size, [](void *data, void *) { std::free(data); },
+      nullptr);
+}
+
+/**
+ * @brief Share frames with another message; 0MQ shares the bytes of all but
+ * the smallest messages rather than copying them
+ *
+ * @param[in] frames Frames to share
+ * @return std::vector<zmq::message_t> Frames holding the same bytes
+ */
+inline std::vector<zmq::message_t> share(std::vector<zmq::message_t> &frames)
+{
+  std::vector<zmq::message_t> shared(frames.size());
+  for (std::size_t i = 0; i < frames.size(); ++i)
+  {
+    shared[i].copy(frames[i]);
+  }
+  return shared;
+}
+
+/**
+ * @brief Get the calling thread's reusable pack buffer, emptied
+ *
+ * The buffer keeps its memory from one use to the next, so packing a reply
+ * does not allocate once the buffer has grown to fit. The contents are only
+ * valid until the next call on the same thread.
+ *
+ * @return msgpack::sbuffer& Empty buffer owned by the calling thread
+ */
+inline msgpack::sbuffer &scratch(void)
+{
+  thread_local msgpack::sbuffer sbuf;
+  sbuf.clear();
+  return sbuf;
+}
+
+/**
+ * @brief Get the calling thread's zone for decoding requests
+ *
+ * The server clears the zone as it starts on each request, so anything
+ * allocated from it is only valid while that request is being handled.
+ *
+ * @return msgpack::zone& Zone owned by the calling thread
+ */
+inline msgpack::zone &arena(void)
+{
+  thread_local msgpack::zone zone;
+  return zone;
+}
+
+/**
+ * @brief Hash of strings that also hashes string views, letting maps keyed by
+ * strings be searched for a view without building a string from it
+ */
+struct StringHash
+{
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view str) const noexcept
+  {
+    return std::hash<std::string_view>{}(str);
+  }
+};
+
+}  // namespace support
+
+/**
+ * @brief Priority of an RPC within its pool; queued requests of a higher
+ * priority are always started first
+ */
+enum class Priority : std::uint8_t
+{
+  high = 0,
+  normal = 1,
+  low = 2
+};
+
+/**
+ * @brief Options assigning a bound RPC to a worker pool and priority lane
+ */
+struct BindOptions
+{
+  /**
+   * @brief Name of the pool, created with `Server::addPool`, to run the RPC
+   * on; empty for the default pool
+   */
+  std::string m_pool;
+
+  /**
+   * @brief Priority of the RPC within its pool
+   */
+  Priority m_priority{Priority::normal};
+
+  /**
+   * @brief Maximum number of calls to the RPC queued or in progress, beyond
+   * which calls are rejected as overloaded; 0 for no limit
+   */
+  std::size_t m_maxInflight{0};
+
+  /**
+   * @brief Limits of the cache of the RPC's replies, for pure functions whose
+   * result depends only on their arguments; caching is off by default
+   */
+  CachePolicy m_cache{};
+
+  /**
+   * @brief Whether calls made with the same arguments while one is already in
+   * progress wait for its reply instead of running again
+   *
+   * Coalesced calls run to completion for everyone waiting on them, so they
+   * are not dropped when the first caller's deadline passes or it cancels.
+   */
+  bool m_coalesce{false};
+};
+
+struct Error;
+class Stub;
+
+/**
+ * @class CancellationToken zRPC.hpp "zRPC.hpp"
+ *
+ * @brief Signals that the caller of an RPC no longer wants its result.
+ *
+ * All copies of a token share the same state, so a token may be copied to
+ * whichever thread does the work and polled there.
+ */
+class CancellationToken
+{
+public:
+  /**
+   * @brief Construct a new zRPC::CancellationToken object, not cancelled
+   */
+  CancellationToken(void);
+
+  /**
+   * @brief Check whether the token has been cancelled
+   *
+   * @return true Result is no longer wanted
+   * @return false Work should carry on
+   */
+  bool cancelled(void) const;
+
+  /**
+   * @brief Cancel the token and all of its copies
+   */
+  void cancel(void);
+
+private:
+  /**
+   * @brief Cancellation flag shared by all copies of the token
+   */
+  std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+/**
+ * @class Context zRPC.hpp "zRPC.hpp"
+ *
+ * @brief Describes the request an RPC is executing on behalf of.
+ *
+ * The server drops requests whose deadline has passed or that the client has
+ * cancelled before they start. Bound functions reach the context of their
+ * request through `Context::current()` and may check it to abort long work
+ * early, or pass `remaining()` on as the timeout of any RPC they call in turn.
+ */
+class Context
+{
+public:
+  /**
+   * @brief Clock the deadline is measured against
+   */
+  using clock_type = std::chrono::steady_clock;
+
+  /**
+   * @brief Construct a new zRPC::Context object without a deadline
+   */
+  Context(void) = default;
+
+  /**
+   * @brief Construct a new zRPC::Context object with the given deadline
+   *
+   * @param[in] deadline Time after which the caller no longer waits for the
+   * reply
+   * @param[in] token Token cancelled when the caller abandons the request
+   */
+  explicit Context(clock_type::time_point deadline,
+                   CancellationToken token = CancellationToken());
+
+  /**
+   * @brief Get the time after which the caller no longer waits for the reply
+   *
+   * @return clock_type::time_point Deadline, or the maximum time point if the
+   * caller waits forever
+   */
+  clock_type::time_point deadline(void) const;
+
+  /**
+   * @brief Check whether the caller has given up on the reply
+   *
+   * @return true Deadline has passed
+   * @return false Reply is still awaited
+   */
+  bool expired(void) const;
+
+  /**
+   * @brief Get the time left before the deadline
+   *
+   * @return std::chrono::milliseconds Time left, 0 once expired, or the
+   * maximum duration if there is no deadline
+   */
+  std::chrono::milliseconds remaining(void) const;
+
+  /**
+   * @brief Get the token cancelled when the caller abandons the request
+   *
+   * @return const CancellationToken& Cancellation token of the request
+   */
+  const CancellationToken &token(void) const;
+
+  /**
+   * @brief Check whether the caller has cancelled the request
+   *
+   * @return true Request has been cancelled
+   * @return false Reply is still wanted
+   */
+  bool cancelled(void) const;
+
+  /**
+   * @brief Get the context of the request being executed on the calling
+   * thread
+   *
+   * Functions returning a zRPC::Task must copy the context before they first
+   * suspend, and those taking a zRPC::Responder should use
+   * `Responder::context()` instead.
+   *
+   * @return const Context& Context of the request, or a context without a
+   * deadline outside of a bound function
+   */
+  static const Context &current(void);
+
+private:
+  /**
+   * @brief Time after which the caller no longer waits for the reply
+   */
+  clock_type::time_point m_deadline{clock_type::time_point::max()};
+
+  /**
+   * @brief Token cancelled when the caller abandons the request
+   */
+  CancellationToken m_token;
+};
+
+/**
+ * @class Responder zRPC.hpp "zRPC.hpp"
+ *
+ * @brief Completes an RPC whose reply is deferred.
+ *
+ * Functions bound with a Responder as their first parameter return at once,
+ * freeing the server thread, and reply later from any thread through the
+ * responder or any copy of it. Only the first reply is sent; if every copy is
+ * destroyed without replying, the client receives an Error instead.
+ */
+class Responder
+{
+public:
+  /**
+   * @brief Callback alias declaration for sending the reply, specifying the
+   * required prototype; the packed result is only valid during the call,
+   * `frames` holds the frames of the blobs it refers to, and `failed` is set
+   * when the reply is an Error
+   */
+  using done_type = std::function<void(msgpack::sbuffer &packed,
+                                       std::vector<zmq::message_t> frames,
+                                       bool failed)>;
+
+private:
+  /**
+   * @brief State shared by all copies of a responder
+   */
+  struct State
+  {
+    done_type m_done;
+    Context m_context;
+    std::atomic<bool> m_replied{false};
+
+    ~State();
+  };
+
+  /**
+   * @brief Shared reply state
+   */
+  std::shared_ptr<State> m_state;
+
+  /**
+   * @brief Send the first reply given, ignoring any later ones
+   *
+   * @param[in] packed Packed result to reply with
+   * @param[in] frames Frames of the blobs the result refers to
+   * @param[in] failed Whether the result is an Error
+   */
+  void finish(msgpack::sbuffer &packed,
+              std::vector<zmq::message_t> frames,
+              bool failed);
+
+public:
+  /**
+   * @brief Construct a new zRPC::Responder object
+   *
+   * @param[in] done Callback sending the reply
+   * @param[in] context Context of the request being replied to
+   */
+  explicit Responder(done_type done, const Context &context = Context());
+
+  /**
+   * @brief Get the context of the request being replied to
+   *
+   * @return const Context& Context of the request
+   */
+  const Context &context(void) const;
+
+  /**
+   * @brief Reply with a MessagePack-able value
+   *
+   * @tparam T MessagePack-able object type
+   * @param[in] value Value to reply with
+   */
+  template <typename T>
+  void reply(const T &value);
+
+  /**
+   * @brief Reply with an empty result, as returned by a void function
+   */
+  void reply(void);
+
+  /**
+   * @brief Reply with a zRPC::Error
+   *
+   * @param[in] msg Error message
+   */
+  void error(const std::string &msg);
+};
+
 /**
  * @class Server zRPC.hpp "zRPC.hpp"
  *
@@ -54,175 +627,1200 @@ namespace zRPC
  * procedure calls, indexed by name. Functions must be bound before the server
  * is started to ensure that the RPC is available when the client connects. Once
  * all RPCs are bound, the `start` function will start the server listening.
+ *
+ * Each bound function is also assigned a compact method id, which clients
+ * learn through the reserved `zrpc.describe` RPC and send in place of the name.
+ * The upper 16 bits of a method id hold a fingerprint of the method table, so
+ * ids cached against a server that has since been restarted with different
+ * bindings are rejected rather than dispatched to the wrong function.
+ *
+ * Requests are received on a single I/O thread, which hands them to a
+ * work-stealing thread pool to execute. Replies are passed back to the I/O
+ * thread to send, so the number of threads running bound functions is
+ * independent of the sockets.
  */
 class Server
 {
 private:
-  using functor_type = std::function<std::unique_ptr<msgpack::object_handle>(
-      msgpack::object const &)>;
+  /**
+   * @brief Bound RPC wrapper, replying through the responder either before it
+   * returns or later on
+   */
+  using functor_type =
+      std::function<void(msgpack::object const &, Responder &)>;
+
+  /**
+   * @brief Received request, shared by everything replying to it
+   */
+  struct Request
+  {
+    zmq::message_t m_identity;
+    zmq::message_t m_payload;
+    Context m_context;
+
+    /**
+     * @brief Frames of the blobs passed as arguments
+     */
+    std::vector<zmq::message_t> m_frames;
+
+    /**
+     * @brief Key of the request in the table of active requests
+     */
+    std::string m_key;
+
+    /**
+     * @brief Packed arguments the reply is cached and coalesced under, or
+     * empty if the RPC does neither
+     */
+    std::string m_argsKey;
+
+    /**
+     * @brief Whether the reply is an Error
+     */
+    bool m_failed{false};
+
+    /**
+     * @brief Index of the pool the request runs on
+     */
+    std::uint32_t m_pool{0};
+
+    /**
+     * @brief Method index of the RPC called, or 0 for batches and unknown
+     * RPCs
+     */
+    std::uint32_t m_method{0};
+
+    /**
+     * @brief Whether the request has handed back its pool slot, which it does
+     * when its handler returns or when it replies, whichever comes first
+     */
+    std::atomic<bool> m_released{false};
+  };
+  using request_type = std::shared_ptr<Request>;
+
+  /**
+   * @brief Packed reply of a pure RPC, kept to answer later calls with the
+   * same arguments
+   */
+  struct CachedReply
+  {
+    std::string m_payload;
+    Integrity m_integrity;
+
+    /**
+     * @brief Checksum of the payload alone, sealed with the header of each
+     * reply it answers
+     */
+    std::uint32_t m_checksum;
+    std::uint16_t m_flags;
+  };
+
+  /**
+   * @brief Pool, priority, admission limit and reply cache of a bound RPC
+   */
+  struct Lane
+  {
+    std::uint32_t m_pool{0};
+    Priority m_priority{Priority::normal};
+
+    /**
+     * @brief Maximum number of calls queued or in progress; 0 for no limit
+     */
+    std::size_t m_limit{0};
+
+    /**
+     * @brief Number of calls queued or in progress, owned by the I/O thread
+     */
+    std::size_t m_inflight{0};
+
+    /**
+     * @brief Replies indexed by packed arguments, owned by the I/O thread;
+     * null if the RPC is not cached
+     */
+    std::unique_ptr<support::LruCache<std::string, CachedReply>> m_cache;
+
+    /**
+     * @brief Whether identical concurrent calls are coalesced
+     */
+    bool m_coalesce{false};
+
+    /**
+     * @brief Clients waiting on the call in progress with the same packed
+     * arguments, owned by the I/O thread
+     */
+    std::unordered_map<std::string,
+                       std::vector<std::pair<zmq::message_t, Header>>>
+        m_flights;
+  };
+
+  /**
+   * @brief Lanes of the bound RPCs, indexed by method index - 1
+   */
+  std::vector<Lane> m_lanes;
+
+  /**
+   * @brief Bound RPC function calls, indexed by method index - 1
+   */
+  std::vector<functor_type> m_rpcs;
+
+  /**
+   * @brief Map of bound RPC names to their method index, searchable by view
+   */
+  std::unordered_map<std::string, std::uint32_t, support::StringHash,
+                     std::equal_to<>>
+      m_methods;
+
+  /**
+   * @brief Lane of batches and unknown RPCs, owned by the I/O thread
+   */
+  Lane m_defaultLane;
+
+  /**
+   * @brief FNV-1a hash of the bound RPC names, in binding order
+   */
+  std::uint32_t m_tableHash{2166136261U};
+
+  /**
+   * @brief Zero-MQ context for the server
+   */
+  zmq::context_t m_ctx;
+
+  /**
+   * @brief Zero-MQ RPC front-end socket (ROUTER), owned by the I/O thread
+   */
+  zmq::socket_t m_frontend;
+
+  /**
+   * @brief Wake-up socket (PUSH) signalling the I/O thread that replies are
+   * ready to send
+   */
+  zmq::socket_t m_wakeTx;
+
+  /**
+   * @brief Wake-up socket (PULL) drained by the I/O thread
+   */
+  zmq::socket_t m_wakeRx;
+
+  /**
+   * @brief Maximum number of requests queued or in progress, beyond which
+   * requests are rejected as overloaded
+   */
+  std::size_t m_maxPending;
+
+  /**
+   * @brief Flag indicating that the server is currently running
+   */
+  bool m_running{false};
+
+  /**
+   * @brief Reply to a request, handed from the thread pool back to the I/O
+   * thread
+   */
+  struct Completion
+  {
+    zmq::message_t m_identity;
+    zmq::message_t m_header;
+    zmq::message_t m_payload;
+
+    /**
+     * @brief Frames of the blobs returned, sent after the payload
+     */
+    std::vector<zmq::message_t> m_frames;
+
+    /**
+     * @brief Whether there is a reply to send; one-way requests complete
+     * without one
+     */
+    bool m_reply{false};
+
+    /**
+     * @brief Whether the server is to stop once the reply is sent
+     */
+    bool m_terminate{false};
+
+    /**
+     * @brief Whether the request is complete; a handler that returns before
+     * replying only hands back its pool slot
+     */
+    bool m_complete{true};
+
+    /**
+     * @brief Whether the request hands back its pool slot
+     */
+    bool m_release{false};
+
+    /**
+     * @brief Index of the pool the request ran on
+     */
+    std::uint32_t m_pool{0};
+
+    /**
+     * @brief Method index of the RPC the request called
+     */
+    std::uint32_t m_method{0};
+
+    /**
+     * @brief Key of the request in the table of active requests
+     */
+    std::string m_key;
+
+    /**
+     * @brief Packed arguments the reply is cached and coalesced under, or
+     * empty
+     */
+    std::string m_argsKey;
+
+    /**
+     * @brief Whether the reply is an Error, which is never cached
+     */
+    bool m_failed{false};
+
+    /**
+     * @brief Checksum of the reply payload alone, kept with a cached reply
+     */
+    std::uint32_t m_sum{0};
+  };
+
+  /**
+   * @brief Mutex protecting the completion queue and the wake-up socket
+   */
+  std::mutex m_completionMtx;
+
+  /**
+   * @brief Requests completed by the thread pool, waiting for the I/O thread
+   */
+  std::deque<Completion> m_completions;
+
+  /**
+   * @brief Number of threads waiting on futures returned by handlers
+   */
+  static constexpr std::uint32_t maxWaiters = 4;
+
+  /**
+   * @brief Threads waiting on futures returned by handlers, each replying once
+   * its result is ready, created when the first such RPC is bound
+   */
+  std::unique_ptr<ThreadPool> m_waiters;
+
+  /**
+   * @brief Cancellation tokens of the requests queued or in progress, indexed
+   * by client identity and request identifier, owned by the I/O thread
+   */
+  std::unordered_map<std::string, CancellationToken> m_active;
+
+  /**
+   * @brief Worker pool with its own threads and queues, isolating the RPCs
+   * bound to it from those on other pools
+   */
+  struct Pool
+  {
+    std::unique_ptr<ThreadPool> m_threads;
+
+    /**
+     * @brief Maximum number of requests whose handlers run on the pool at once
+     */
+    std::size_t m_limit{0};
+
+    /**
+     * @brief Number of requests whose handlers run on the pool, owned by the
+     * I/O thread
+     */
+    std::size_t m_inflight{0};
+
+    /**
+     * @brief Maximum number of requests waiting for the pool, beyond which
+     * requests are rejected as overloaded; 0 for no limit
+     */
+    std::size_t m_maxQueued{0};
+
+    /**
+     * @brief Number of requests waiting for the pool, owned by the I/O thread
+     */
+    std::size_t m_queued{0};
+
+    /**
+     * @brief Requests waiting for the pool, one queue per priority, owned by
+     * the I/O thread
+     */
+    std::array<std::deque<std::pair<request_type, Header>>, 3> m_backlog;
+  };
+
+  /**
+   * @brief Worker pools, the first being the default pool
+   */
+  std::vector<Pool> m_pools;
+
+  /**
+   * @brief Map of pool names to their index
+   */
+  std::unordered_map<std::string, std::uint32_t> m_poolIds;
+
+  /**
+   * @brief Find the RPC called by a received request
+   *
+   * @param[in] hdr Decoded request header
+   * @param[in] msg Request payload frame
+   * @return std::uint32_t Method index, or 0 for batches and unknown RPCs,
+   * which run on the default lane
+   */
+  std::uint32_t lane(const Header &hdr, const zmq::message_t &msg) const;
+
+  /**
+   * @brief Reply to a request from the I/O thread without executing it
+   *
+   * @param[in] identity Client identity to reply to
+   * @param[in] hdr Header of the request being rejected
+   * @param[in] err Error to reply with
+   */
+  void reject(zmq::message_t &identity, const Header &hdr, const Error &err);
+
+  /**
+   * @brief Reply to a request from the I/O thread with a reply already packed
+   * for another request
+   *
+   * @param[in] identity Client identity to reply to
+   * @param[in] hdr Header of the request being answered
+   * @param[in] cached Packed reply to send
+   * @param[in] frames Frames of the blobs the reply refers to
+   */
+  void replay(zmq::message_t &identity,
+              const Header &hdr,
+              const CachedReply &cached,
+              std::vector<zmq::message_t> frames = {});
+
+  /**
+   * @brief Start queued requests on a pool, highest priority first, until the
+   * pool reaches its limit
+   *
+   * @param[in] pool Pool to start requests on
+   */
+  void schedule(Pool &pool);
+
+  /**
+   * @brief Hand back the pool slot of a request whose handler has returned,
+   * unless it has already replied
+   *
+   * @param[in] req Request whose handler returned
+   */
+  void release(Request &req);
+
+  /**
+   * @brief Decode and execute a request, handing its reply to the I/O thread
+   * once the RPC completes
+   *
+   * Runs on the thread pool.
+   *
+   * @param[in] req Received request frames
+   * @param[in] hdr Decoded request header
+   */
+  void process(request_type req, Header hdr);
+
+  /**
+   * @brief Build the callback replying to a request
+   *
+   * @param[in] req Received request frames
+   * @param[in] hdr Decoded request header
+   * @return Responder::done_type Callback sending the reply
+   */
+  Responder::done_type respond(request_type req, const Header &hdr);
+
+  /**
+   * @brief Queue a completed request for the I/O thread, waking it if it has
+   * nothing else queued
+   *
+   * @param[in] done Completed request
+   */
+  void complete(Completion &&done);
+
+  /**
+   * @brief Wait on a deferred result on one of the waiter threads, which
+   * replies through the completion queue as soon as the result is ready
+   *
+   * A std::future cannot report that it is ready, so it is waited on rather
+   * than polled. At most maxWaiters futures are waited on at once; the others
+   * queue for a waiter, still counted against the server and RPC limits.
+   *
+   * @param[in] wait Function waiting on the result and replying with it
+   */
+  void watch(std::function<void()> wait);
+
+  /**
+   * @brief Execute a single RPC by name
+   *
+   * @param[in] name Name of the RPC
+   * @param[in] args MsgPack array of arguments to the RPC
+   * @param[in] res Responder receiving the result of the RPC, or an Error if
+   * it could not be executed
+   */
+  void execute(const std::string &name,
+               const msgpack::object &args,
+               Responder &res);
+
+  /**
+   * @brief Execute a single RPC by method id
+   *
+   * @param[in] method Method id of the RPC, as returned by `zrpc.describe`
+   * @param[in] args MsgPack array of arguments to the RPC
+   * @param[in] res Responder receiving the result of the RPC, or an Error if
+   * it could not be executed
+   */
+  void execute(std::uint32_t method,
+               const msgpack::object &args,
+               Responder &res);
+
+  /**
+   * @brief Check that a method id belongs to the current method table
+   *
+   * @param[in] method Method id to check
+   * @return true Method id can be dispatched
+   * @return false Method id is unknown or from a different method table
+   */
+  bool current(std::uint32_t method) const;
+
+  /**
+   * @brief Build the reply to the reserved `zrpc.describe` RPC
+   *
+   * @return std::unordered_map<std::string, std::uint32_t> Map of RPC names
+   * to method ids, along with the byte order of raw values under
+   * `zrpc.byteorder`
+   */
+  std::unordered_map<std::string, std::uint32_t> describe(void) const;
+
+  /**
+   * @brief Fingerprint of the method table, carried in the upper 16 bits of
+   * each method id
+   *
+   * @return std::uint32_t Non-zero 16-bit fingerprint
+   */
+  std::uint32_t fingerprint(void) const;
+
+  /**
+   * @brief Reply to client with identity with provided result, or just
+   * complete the request if it is one-way
+   *
+   * @param[in] req Request being replied to
+   * @param[in] hdr Header of the request being replied to
+   * @param[in] packed Packed result to reply with
+   * @param[in] frames Frames of the blobs the result refers to
+   * @param[in] terminate Whether to stop the server once the reply is sent
+   */
+  void reply(Request &req,
+             const Header &hdr,
+             msgpack::sbuffer &packed,
+             std::vector<zmq::message_t> frames = {},
+             const bool terminate = false);
+
+public:
+  /**
+   * @brief Construct a new zRPC::Server object listening on all interfaces on
+   * the specified port with the specified number of worker threads
+   *
+   * @param[in] port Port to listen on
+   * @param[in] nWorkers Number of thread pool threads to create, which is
+   * also the number of handlers run at once on the default pool, default = 16
+   * @param[in] maxPending Maximum number of requests queued or in progress,
+   * beyond which requests are rejected as overloaded, default = 1024
+   */
+  explicit Server(const uint16_t port,
+                  const uint32_t nWorkers = 16U,
+                  const std::size_t maxPending = 1024U);
+
+  /**
+   * @brief Construct a new zRPC::Server object listening on the specified
+   * address and port with the specified number of worker threads
+   *
+   * @param[in] uri Zero-MQ address:port to bind listening socket to.
+   * @param[in] nWorkers Number of thread pool threads to create, which is
+   * also the number of handlers run at once on the default pool, default = 16
+   * @param[in] maxPending Maximum number of requests queued or in progress,
+   * beyond which requests are rejected as overloaded, default = 1024
+   */
+  explicit Server(const std::string &uri,
+                  const uint32_t nWorkers = 16U,
+                  const std::size_t maxPending = 1024U);
+
+  ~Server();
+
+  /**
+   * @brief Start listening for client connections, running the I/O loop on
+   * the calling thread until the server is stopped
+   */
+  void start(void);
+
+  /**
+   * @brief Stop the RPC server
+   */
+  void stop(void);
+
+  /**
+   * @brief Add a named worker pool for RPCs to be bound to
+   *
+   * RPCs bound to a pool run only on its threads and queue only behind each
+   * other, so a flood of calls to one pool cannot starve the others. Pools
+   * must be added before the RPCs bound to them.
+   *
+   * @param[in] name Name of the pool
+   * @param[in] nThreads Number of threads to create for the pool
+   * @param[in] maxConcurrent Maximum number of handlers run at once on the
+   * pool, not counting deferred requests that have returned and wait to reply,
+   * which are bounded by the server and RPC limits instead; 0 for one per
+   * thread
+   * @param[in] maxQueued Maximum number of requests waiting for the pool,
+   * beyond which requests are rejected as overloaded; 0 for no limit
+   */
+  void addPool(const std::string &name,
+               const uint32_t nThreads,
+               const std::size_t maxConcurrent = 0U,
+               const std::size_t maxQueued = 0U);
+
+  /**
+   * @brief Bind a function to an RPC name
+   *
+   * Besides functions returning their result, the following are accepted,
+   * all of which free the server thread as soon as they return:
+   * - functions returning a zRPC::Task, whose result is returned to the client
+   *   once the task completes;
+   * - functions returning a std::future, whose result is returned to the
+   *   client once it is ready;
+   * - functions taking a zRPC::Responder as their first parameter, which reply
+   *   through the responder whenever they are done.
+   *
+   * Parameters viewing their argument, such as `std::string_view` and
+   * `std::span`, are only valid until the function returns, so none of these
+   * may take them.
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Callable object to bind to the RPC name
+   * @param[in] opts Pool, priority, limits and reply cache of the RPC
+   */
+  template <typename F>
+  void bind(const std::string &name, F func, const BindOptions &opts = {});
+
+  /**
+   * @brief Bind a function handling many calls at once to an RPC name
+   *
+   * The function takes a `std::vector` of arguments, one element per call,
+   * and returns a `std::vector` of results in the same order. Clients call
+   * the RPC as usual, with the arguments of a single element; an element type
+   * that is a `std::tuple` takes one argument per tuple member. Calls arriving
+   * together are gathered until `maxBatch` are waiting or `window` has passed
+   * since the first, then handed to the function in one go:
+   * @code
+   * srv.bind_batch("score",
+   *                [](std::vector<double> x)
+   *                {
+   *                  std::vector<double> y(x.size());
+   *                  // ...
+   *                  return y;
+   *                });
+   * @endcode
+   *
+   * A full batch runs on the server thread of the call that filled it, while
+   * one cut short by the window runs on a thread the RPC keeps for that, so
+   * no server thread waits for calls to join. Calls whose caller has timed
+   * out or cancelled by then are left out.
+   *
+   * As batches run after their calls return, elements cannot view their
+   * arguments with types such as `std::string_view` and `std::span`.
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Callable object to bind to the RPC name
+   * @param[in] maxBatch Maximum number of calls handed to the function at
+   * once, default = 64
+   * @param[in] window Longest time the first call of a batch waits for others,
+   * default = 200 us
+   * @param[in] opts Pool, priority, limits and reply cache of the RPC
+   */
+  template <typename F>
+  void bind_batch(
+      const std::string &name,
+      F func,
+      const std::size_t maxBatch = 64U,
+      const std::chrono::microseconds window = std::chrono::microseconds(200),
+      const BindOptions &opts = {});
+
+private:
+  /**
+   * @brief Insert non-void returning function into RPC map
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Function to call
+   * @param support::void_rtn type to differentiate insert from non-void
+   */
+  template <typename F>
+  void insertFunc(const std::string &name,
+                  F func,
+                  support::nonvoid_rtn const &);
+
+  /**
+   * @brief Insert void returning function into RPC map
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Function to call
+   * @param support::void_rtn type to differentiate insert from non-void
+   */
+  template <typename F>
+  void insertFunc(const std::string &name, F func, support::void_rtn const &);
+
+  /**
+   * @brief Insert function returning a zRPC::Task into RPC table
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Function to call
+   */
+  template <typename F>
+  void insertTask(const std::string &name, F func);
+
+  /**
+   * @brief Insert function returning a std::future into RPC table
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Function to call
+   */
+  template <typename F>
+  void insertFuture(const std::string &name, F func);
+
+  /**
+   * @brief Insert function taking a zRPC::Responder into RPC table
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Function to call
+   */
+  template <typename F>
+  void insertDeferred(const std::string &name, F func);
+
+  /**
+   * @brief Insert function handling a batch of calls into RPC table
+   *
+   * @tparam F Callable type to bind (auto-detected by compiler)
+   * @param[in] name Name of the RPC
+   * @param[in] func Function to call
+   * @param[in] maxBatch Maximum number of calls handed to the function at
+   * once
+   * @param[in] window Longest time the first call of a batch waits for others
+   */
+  template <typename F>
+  void insertBatch(const std::string &name,
+                   F func,
+                   std::size_t maxBatch,
+                   std::chrono::microseconds window);
+
+  /**
+   * @brief Check that an RPC name and its options can be bound
+   *
+   * @param[in] name Name of the RPC
+   * @param[in] opts Pool and priority to run the RPC with
+   */
+  void validate(const std::string &name, const BindOptions &opts) const;
+
+  /**
+   * @brief Assign the next method index to a newly bound RPC
+   *
+   * @param[in] name Name of the RPC
+   * @param[in] opts Pool and priority to run the RPC with
+   */
+  void assign(const std::string &name, const BindOptions &opts);
+};
+
+/**
+ * @class Client zRPC.hpp "zRPC.hpp"
+ *
+ * @brief Implements a 0MQ-based client.
+ *
+ * This provides a mechanism to call the RPC just like a regular function with
+ * arguments, with the first argument always being the name of the RPC. If the
+ * arguments do not match the function on the remote server, an error is
+ * returned from the server.
+ */
+class Client
+{
+public:
+  /**
+   * @brief Callback alias declaration for asynchronous calls, specifying the
+   * required prototype
+   */
+  using cb_type = std::function<void(msgpack::object_handle &res)>;
+
+private:
+  friend class Stub;
 
-  /**
-   * @brief Map of bound RPC function calls
-   */
-  std::unordered_map<std::string, functor_type> m_rpcs;
+  // Delete copy constructor
+  Client(Client const &) = delete;
 
   /**
-   * @brief Zero-MQ context for the server
+   * @brief Zero-MQ context for the client
    */
   zmq::context_t m_ctx;
 
   /**
-   * @brief Zero-MQ RPC broker front-end socket (ROUTER)
+   * @brief Identity base string to discriminate between connections
    */
-  zmq::socket_t m_brokerFrontend;
+  std::string m_idBase;
 
   /**
-   * @brief Zero-MQ RPC broker back-end socket (DEALER)
+   * @brief Index of the next connection created by the client, used to build
+   * unique routing identities
    */
-  zmq::socket_t m_brokerBackend;
+  std::atomic<uint64_t> m_idx{0};
 
   /**
-   * @brief Vector of thread handler for main worker threads
+   * @brief URI of the server (protocol and address:port) to connect to
    */
-  std::vector<std::thread> m_th;
+  std::string m_uri;
 
   /**
-   * @brief Flag indicating that the server is currently running
+   * @brief Integrity check applied to outgoing payloads
    */
-  bool m_running{false};
+  Integrity m_integrity;
 
   /**
-   * @brief CRC table for use in efficient CRC calculations
+   * @brief Mutex protecting the pool of idle connections
    */
-  CRC::Table<std::uint32_t, 32> m_crcTable;
+  std::mutex m_poolMtx;
 
   /**
-   * @brief Worker thread function
+   * @brief Pool of idle, already connected sockets available for reuse
+   *
+   * A socket is checked out of the pool for the duration of a single call, so
+   * each socket is only ever used by one thread at a time. Sockets that time
+   * out are closed instead of being returned, so a late reply can never be
+   * delivered to the next caller.
    */
-  void worker(void);
+  std::vector<zmq::socket_t> m_pool;
 
   /**
-   * @brief Reply to client with identity on provided socket with provided
-   * result
+   * @brief Take an idle connection from the pool, creating and connecting a
+   * new one if none are available
    *
-   * @param[in] sock Socket to reply on
-   * @param[in] identity Client identity to reply to
-   * @param[in] res MsgPack object to reply with
+   * @return zmq::socket_t Connected DEALER socket owned by the caller
    */
-  void reply(zmq::socket_t &sock,
-             zmq::message_t &identity,
-             std::unique_ptr<msgpack::object_handle> &res) const;
+  zmq::socket_t acquire(void);
 
-public:
   /**
-   * @brief Construct a new zRPC::Server object listening on all interfaces on
-   * the specified port with the specified number of worker threads
+   * @brief Return a connection to the pool for reuse by later calls
    *
-   * @param[in] port Port to listen on
-   * @param[in] nWorkers Number of worker threads to create, default = 16
+   * @param[in] sock Socket previously obtained from `acquire`
    */
-  explicit Server(const uint16_t port, const uint32_t nWorkers = 16U);
+  void release(zmq::socket_t &&sock);
 
   /**
-   * @brief Construct a new zRPC::Server object listening on the specified
-   * address and port with the specified number of worker threads
-   *
-   * @param[in] uri Zero-MQ address:port to bind listening socket to.
-   * @param[in] nWorkers Number of worker threads to create, default = 16
+   * @brief Identifier of the next request, echoed back by the server in the
+   * reply header
    */
-  explicit Server(const std::string &uri, const uint32_t nWorkers = 16U);
+  std::atomic<uint64_t> m_reqId{0};
 
-  ~Server();
+  /**
+   * @brief Mutex protecting the asynchronous request queue and pending map
+   */
+  std::mutex m_asyncMtx;
 
   /**
-   * @brief Start listening for client connections and setup worker pool
+   * @brief Outstanding asynchronous request
    */
-  void start(void);
+  struct Pending
+  {
+    /**
+     * @brief Callback to call when the reply is received
+     */
+    cb_type m_cb;
+
+    /**
+     * @brief Name of the RPC when the request carries its method id, so that
+     * the request can be sent again by name should the id be stale
+     */
+    std::string m_name;
+
+    /**
+     * @brief Packed arguments of a request carrying a method id
+     */
+    zmq::message_t m_args;
+
+    /**
+     * @brief Frames of the blobs passed to a request carrying a method id
+     */
+    std::vector<zmq::message_t> m_frames;
+  };
 
   /**
-   * @brief Stop the RPC server
+   * @brief Outstanding asynchronous requests, indexed by request identifier
    */
-  void stop(void);
+  std::unordered_map<uint64_t, Pending> m_pending;
 
   /**
-   * @brief Bind a function to an RPC name
+   * @brief Queue socket (PUSH) used by callers to hand asynchronous requests
+   * to the I/O thread
+   */
+  zmq::socket_t m_asyncTx;
+
+  /**
+   * @brief Queue socket (PULL) drained by the I/O thread
+   */
+  zmq::socket_t m_asyncRx;
+
+  /**
+   * @brief Single connection (DEALER) that multiplexes all asynchronous
+   * requests to the server
+   */
+  zmq::socket_t m_asyncSock;
+
+  /**
+   * @brief Thread handler for the asynchronous I/O thread
+   */
+  std::thread m_ioThread;
+
+  /**
+   * @brief Mutex protecting the cached method table
+   */
+  std::shared_mutex m_methodMtx;
+
+  /**
+   * @brief Method ids of the server's RPCs, indexed by name
+   */
+  std::unordered_map<std::string, std::uint32_t> m_methods;
+
+  /**
+   * @brief Flag indicating that the server has been described
+   */
+  std::atomic<bool> m_described{false};
+
+  /**
+   * @brief Mutex protecting the result caches
+   */
+  std::mutex m_cacheMtx;
+
+  /**
+   * @brief Packed results of cached RPCs, indexed by RPC name and then by
+   * packed request payload
+   */
+  std::unordered_map<std::string, support::LruCache<std::string, std::string>>
+      m_caches;
+
+  /**
+   * @brief Flag indicating that any RPC is cached, sparing calls the lock
+   * otherwise
+   */
+  std::atomic<bool> m_caching{false};
+
+  /**
+   * @brief Number of invalidations so far, so that results of calls sent
+   * before an invalidation are not cached after it
+   */
+  std::uint64_t m_cacheEpoch{0};
+
+  /**
+   * @brief Look up the cached result of a call
    *
-   * @tparam F Callable type to bind (auto-detected by compiler)
    * @param[in] name Name of the RPC
-   * @param[in] func Callable object to bind to the RPC name
+   * @param[in] payload Packed request payload
+   * @param[out] key Key to store the result under, or empty if the RPC is not
+   * cached
+   * @param[out] epoch Invalidation count to store the result against
+   * @param[out] res Cached result
+   * @return true Result was found in the cache
+   * @return false Call must be sent to the server
    */
-  template <typename F>
-  void bind(const std::string &name, F func);
+  bool lookup(const std::string &name,
+              const msgpack::sbuffer &payload,
+              std::string &key,
+              std::uint64_t &epoch,
+              msgpack::object_handle &res);
 
-private:
   /**
-   * @brief Insert non-void returning function into RPC map
+   * @brief Cache the result of a call
    *
-   * @tparam F Callable type to bind (auto-detected by compiler)
    * @param[in] name Name of the RPC
-   * @param[in] func Function to call
-   * @param support::void_rtn type to differentiate insert from non-void
+   * @param[in] key Key returned by `lookup`
+   * @param[in] epoch Invalidation count returned by `lookup`
+   * @param[in] res Result to cache
    */
-  template <typename F>
-  void insertFunc(const std::string &name,
-                  F func,
-                  support::nonvoid_rtn const &);
+  void store(const std::string &name,
+             std::string &&key,
+             std::uint64_t epoch,
+             const msgpack::object_handle &res);
 
   /**
-   * @brief Insert void returning function into RPC map
+   * @brief Look up the cached method id of an RPC
    *
-   * @tparam F Callable type to bind (auto-detected by compiler)
    * @param[in] name Name of the RPC
-   * @param[in] func Function to call
-   * @param support::void_rtn type to differentiate insert from non-void
+   * @return std::uint32_t Method id, or 0 if the RPC must be called by name
    */
-  template <typename F>
-  void insertFunc(const std::string &name, F func, support::void_rtn const &);
-};
+  std::uint32_t method(const std::string &name);
 
-/**
- * @class Client zRPC.hpp "zRPC.hpp"
- *
- * @brief Implements a 0MQ-based client.
- *
- * This provides a mechanism to call the RPC just like a regular function with
- * arguments, with the first argument always being the name of the RPC. If the
- * arguments do not match the function on the remote server, an error is
- * returned from the server.
- */
-class Client
-{
-private:
-  // Delete copy constructor
-  Client(Client const &) = delete;
+  /**
+   * @brief Get what is left of the timeout of a call spanning several
+   * exchanges with the server
+   *
+   * @param[in] timeout Timeout in ms of the whole call
+   * @param[in] start Time the call started
+   * @return int Timeout in ms left, 0 once it has run out, or the timeout
+   * itself if it is not positive
+   */
+  static int remaining(const int timeout,
+                       const std::chrono::steady_clock::time_point start);
 
   /**
-   * @brief Zero-MQ context for the client
+   * @brief Call an RPC, returning the flags of its reply in the header
+   *
+   * A call sent by method id that the server reports as stale was not run, so
+   * it is sent again by name, and the next call describes the server again.
+   * Describing the server and sending the call again share the timeout of the
+   * call, which is dropped once the timeout runs out.
+   *
+   * @tparam A Variadic argument list
+   * @param[in] timeout Timeout in ms before dropping the request
+   * @param[out] hdr Request header, receiving the flags of the reply
+   * @param[in] name Name of the RPC to call on the remote server
+   * @param[in] args Variadic argument list to pass to the remote server
+   * @return msgpack::object_handle MessagePack'd object handle containing
+   * server response (if any)
    */
-  zmq::context_t m_ctx;
+  template <typename... A>
+  msgpack::object_handle request(const int timeout,
+                                 Header &hdr,
+                                 const std::string &name,
+                                 const A &...args);
 
   /**
-   * @brief Identity base string to discriminate between connections
+   * @brief Pack the RPC arguments into a request payload, along with the RPC
+   * name unless the header carries its method id
+   *
+   * @tparam A Variadic argument list
+   * @param[in] hdr Request header, carrying the method id or 0
+   * @param[out] sbuf Buffer to pack the request into
+   * @param[out] frames Frames of the blobs passed as arguments
+   * @param[in] name Name of the RPC to call on the remote server
+   * @param[in] args Variadic argument list to pass to the remote server
    */
-  std::string m_idBase;
+  template <typename... A>
+  void pack(const Header &hdr,
+            msgpack::sbuffer &sbuf,
+            std::vector<zmq::message_t> &frames,
+            const std::string &name,
+            const A &...args);
 
   /**
-   * @brief Index of the RPC call from the same client
+   * @brief Verify and unpack the payload of a reply
+   *
+   * The returned handle takes over the payload frame and refers to strings and
+   * binary data in it rather than copying them.
+   *
+   * @param[in,out] hdr Decoded reply header, flagged as an error if the
+   * checksum does not match
+   * @param[in,out] msg Reply payload frame, moved into the returned handle
+   * @param[in,out] frames Frames of the blobs the reply refers to, moved into
+   * the returned handle
+   * @return msgpack::object_handle MessagePack'd object handle containing
+   * server response, or an Error if the checksum does not match
    */
-  uint64_t m_idx{0};
+  msgpack::object_handle result(Header &hdr,
+                                zmq::message_t &msg,
+                                std::vector<zmq::message_t> &frames);
 
   /**
-   * @brief URI of the server (protocol and address:port) to connect to on each
-   * RPC call
+   * @brief Send a request on a pooled connection and wait for its reply
+   *
+   * @param[in] timeout Timeout in ms before dropping the request
+   * @param[in,out] hdr Request header, receiving the flags of the reply
+   * @param[in] payload Packed request payload
+   * @param[in] frames Frames of the blobs passed as arguments
+   * @param[in] name Name of the request used in diagnostics
+   * @return msgpack::object_handle MessagePack'd object handle containing
+   * server response, or an empty handle without a zone if there was none
    */
-  std::string m_uri;
+  msgpack::object_handle exchange(const int timeout,
+                                  Header &hdr,
+                                  msgpack::sbuffer &payload,
+                                  std::vector<zmq::message_t> &frames,
+                                  const std::string &name);
+
+  /**
+   * @brief Send a one-way request on a pooled connection without waiting
+   *
+   * @param[in] hdr Request header
+   * @param[in] payload Packed request payload
+   * @param[in] frames Frames of the blobs passed as arguments
+   */
+  void post(Header &hdr,
+            msgpack::sbuffer &payload,
+            std::vector<zmq::message_t> &frames);
+
+  /**
+   * @brief Register the callback for a packed request and queue it to the I/O
+   * thread, starting the thread on first use
+   *
+   * @param[in] hdr Request header
+   * @param[in] cb Callback to call when the reply is received
+   * @param[in] payload Packed request payload
+   * @param[in] frames Frames of the blobs passed as arguments
+   * @param[in] name Name of the RPC
+   */
+  void dispatch(Header &hdr,
+                cb_type cb,
+                msgpack::sbuffer &payload,
+                std::vector<zmq::message_t> &frames,
+                const std::string &name);
+
+  /**
+   * @brief Asynchronous I/O thread function
+   */
+  void ioLoop(void);
+
+  /**
+   * @brief Send an asynchronous request again by name, from the I/O thread,
+   * after the server reported its method id as stale
+   *
+   * @param[in] id Identifier of the request
+   * @param[in,out] pending Request, registered again to wait for the reply
+   */
+  void resend(const std::uint64_t id, Pending &&pending);
 
   /**
-   * @brief CRC table for use in efficient CRC calculations
+   * @brief Awaitable suspending a coroutine until the reply to a packed
+   * request is received
+   *
+   * The coroutine is resumed on the executor it was running on when it
+   * suspended, or directly on the I/O thread if it was not running on one.
    */
-  CRC::Table<std::uint32_t, 32> m_crcTable;
+  struct ReplyAwaiter
+  {
+    Client &m_client;
+    Header &m_hdr;
+    msgpack::sbuffer &m_payload;
+    std::vector<zmq::message_t> &m_frames;
+    const std::string &m_name;
+    msgpack::object_handle m_res;
+
+    bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h);
+
+    msgpack::object_handle await_resume()
+    {
+      return std::move(m_res);
+    }
+  };
 
 public:
+  /**
+   * @class Batch zRPC.hpp "zRPC.hpp"
+   *
+   * @brief Collects several RPC calls to send to the server as a single
+   * request.
+   *
+   * The calls are executed by the server in the order they were added and
+   * answered with one reply, saving a round trip per call:
+   * @code
+   * auto res = client.batch().add("l1", 7, 3).add("l2", 11, 9).call();
+   * @endcode
+   */
+  class Batch
+  {
+  private:
+    /**
+     * @brief Client to send the batch with
+     */
+    Client &m_client;
+
+    /**
+     * @brief Packed (name or method id, arguments) calls added so far
+     */
+    msgpack::sbuffer m_calls;
+
+    /**
+     * @brief Frames of the blobs passed to the calls added so far
+     */
+    std::vector<zmq::message_t> m_frames;
+
+    /**
+     * @brief Number of calls added so far
+     */
+    std::uint32_t m_count{0};
+
+    /**
+     * @brief Call added by method id, kept to be sent again by name should the
+     * id be stale
+     */
+    struct ById
+    {
+      /**
+       * @brief Position of the call in the batch
+       */
+      std::uint32_t m_index;
+
+      /**
+       * @brief Name of the RPC
+       */
+      std::string m_name;
+
+      /**
+       * @brief Range of the packed arguments of the call in the batch
+       */
+      std::size_t m_begin;
+      std::size_t m_end;
+
+      /**
+       * @brief Range of the frames of the blobs passed to the call
+       */
+      std::size_t m_firstFrame;
+      std::size_t m_endFrame;
+    };
+
+    /**
+     * @brief Calls added by method id so far
+     */
+    std::vector<ById> m_byId;
+
+    /**
+     * @brief Send the calls added by method id again by name, after the server
+     * reported the ids as stale and so ran none of them
+     *
+     * @param[in] timeout Timeout in ms left before dropping the request
+     * @param[in,out] results Results of the batch, those of the calls sent
+     * again replaced by their new results
+     */
+    void resend(const int timeout,
+                std::vector<msgpack::object_handle> &results);
+
+  public:
+    /**
+     * @brief Construct a new, empty zRPC::Client::Batch object
+     *
+     * @param[in] client Client to send the batch with
+     */
+    explicit Batch(Client &client);
+
+    /**
+     * @brief Add a call of the RPC with the given name and given arguments
+     *
+     * @tparam A Variadic argument list
+     * @param[in] name Name of the RPC to call on the remote server
+     * @param[in] args Variadic argument list to pass to the remote server
+     * @return Batch& This batch, to allow chaining calls
+     */
+    template <typename... A>
+    Batch &add(const std::string &name, const A &...args);
+
+    /**
+     * @brief Send all calls to the server and wait for their results
+     *
+     * @param[in] timeout Timeout in ms before dropping the request
+     * @return std::vector<msgpack::object_handle> MessagePack'd object handles
+     * containing server responses, in the order the calls were added; empty
+     * if the server did not respond
+     */
+    std::vector<msgpack::object_handle> call(const int timeout = -1);
+  };
+
   /**
    * @brief Construct a new zRPC::Client object
    *
@@ -234,6 +1832,72 @@ public:
    */
   explicit Client(const std::string &identity, const std::string &uri);
 
+  /**
+   * @brief Construct a new zRPC::Client object using the given integrity
+   * check
+   *
+   * The server verifies each request with the check named in its header and
+   * replies using the same check.
+   *
+   * @param[in] identity Identity string to use for the client.
+   * @param[in] uri Zero-MQ address:port to bind listening socket to.
+   * @param[in] integrity Integrity check applied to requests and replies
+   */
+  explicit Client(const std::string &identity, const std::string &uri,
+                  const Integrity integrity);
+
+  ~Client();
+
+  /**
+   * @brief Fetch the method ids of the server's RPCs
+   *
+   * Once described, calls send the compact method id of the RPC instead of
+   * its name. The first blocking call describes the server automatically;
+   * asynchronous calls use the method ids only once they are known. The cache
+   * is dropped whenever the server reports that a method id is stale, and the
+   * calls it did not run for that reason are sent again by name. A server
+   * packing raw values in the other byte order is reported on std::cerr, as
+   * its values sent with RawCodec cannot be decoded; the report is only
+   * advice, and the description still succeeds.
+   *
+   * @param[in] timeout Timeout in ms before giving up on the server
+   * @return true Method ids were fetched, or the server does not provide them
+   * @return false Server did not respond
+   */
+  bool describe(const int timeout = -1);
+
+  /**
+   * @brief Cache the results of an idempotent RPC
+   *
+   * Blocking calls of the RPC with arguments already seen are answered from
+   * the cache, without going to the server, until their result expires or is
+   * evicted. Errors are never cached. Stale results may be dropped when they
+   * change, for instance from a subscriber:
+   * @code
+   * client.cache("config", {100, 0, std::chrono::hours(1)});
+   * s.subscribe<string>("tcp://localhost:54321", "ConfigChanged",
+   *                     [&](const string &, const string &)
+   *                     { client.invalidate("config"); });
+   * @endcode
+   *
+   * @param[in] name Name of the RPC to cache
+   * @param[in] policy Limits of the cache; a zero entry limit stops caching
+   * the RPC
+   */
+  void cache(const std::string &name, const CachePolicy &policy);
+
+  /**
+   * @brief Drop all cached results of an RPC
+   *
+   * @param[in] name Name of the RPC
+   */
+  void invalidate(const std::string &name);
+
+  /**
+   * @brief Drop all cached results of every RPC
+   */
+  void invalidate(void);
+
   /**
    * @brief Call the RPC with the given name and given arguments
    *
@@ -244,7 +1908,7 @@ public:
    * server response (if any)
    */
   template <typename... A>
-  msgpack::object_handle call(const std::string &name, A... args);
+  msgpack::object_handle call(const std::string &name, A &&...args);
 
   /**
    * @brief Call the RPC with the given name and given arguments
@@ -259,7 +1923,102 @@ public:
   template <typename... A>
   msgpack::object_handle call(const int timeout,
                               const std::string &name,
-                              A... args);
+                              A &&...args);
+
+  /**
+   * @brief Call the RPC with the given name and given arguments without
+   * waiting for, or receiving, any reply
+   *
+   * The call returns as soon as the request is queued for sending. The server
+   * executes the RPC but does not reply, so the result (and any error) is
+   * discarded. Requests still queued when the client is destroyed are dropped.
+   * The RPC is always called by name, as without a reply the client could not
+   * tell that its method id had gone stale.
+   *
+   * @tparam A Variadic argument list
+   * @param[in] name Name of the RPC to call on the remote server
+   * @param[in] args Variadic argument list to pass to the remote server
+   */
+  template <typename... A>
+  void notify(const std::string &name, A &&...args);
+
+  /**
+   * @brief Call the RPC with the given name and given arguments without
+   * blocking the caller
+   *
+   * All asynchronous requests from this client share a single connection
+   * serviced by a background I/O thread, so any number of calls may be in
+   * flight at once. Replies are matched to their requests by the identifier
+   * carried in the request header.
+   *
+   * @tparam A Variadic argument list
+   * @param[in] name Name of the RPC to call on the remote server
+   * @param[in] args Variadic argument list to pass to the remote server
+   * @return std::future<msgpack::object_handle> Future that becomes ready with
+   * the server response (if any)
+   */
+  template <typename... A>
+  std::future<msgpack::object_handle> async_call(const std::string &name,
+                                                 A &&...args);
+
+  /**
+   * @brief Call the RPC with the given name and given arguments without
+   * blocking the caller, calling the callback when the reply is received
+   *
+   * @note The callback is called from the I/O thread and should not block,
+   * otherwise all other outstanding replies are delayed. Exceptions it throws
+   * are reported and otherwise ignored.
+   *
+   * @tparam A Variadic argument list
+   * @param[in] cb Callback to call with the server response (if any)
+   * @param[in] name Name of the RPC to call on the remote server
+   * @param[in] args Variadic argument list to pass to the remote server
+   * @return std::uint64_t Identifier of the call, to cancel it with
+   */
+  template <typename... A>
+  std::uint64_t async_call(cb_type cb, const std::string &name, A &&...args);
+
+  /**
+   * @brief Cancel an asynchronous call still waiting for its reply
+   *
+   * The server is told to abandon the request, which it drops if it has not
+   * started it yet and otherwise cancels the token of the handler running it.
+   * The callback of the call is called at once with an empty response, as for
+   * a call that was never answered, and any reply arriving later is ignored.
+   *
+   * @param[in] id Identifier of the call, returned by `async_call`
+   * @return true Call was cancelled
+   * @return false Call had already completed or been cancelled
+   */
+  bool cancel(const std::uint64_t id);
+
+  /**
+   * @brief Call the RPC with the given name and given arguments from a
+   * coroutine
+   *
+   * The request is sent when the returned task is awaited and the awaiting
+   * coroutine is suspended, without blocking its thread, until the reply is
+   * received:
+   * @code
+   * int v = co_await client.co_call<int>("l2", 11, 9);
+   * @endcode
+   *
+   * @tparam R Type to convert the server response to, default is the
+   * MessagePack'd object handle itself
+   * @tparam A Variadic argument list
+   * @param[in] name Name of the RPC to call on the remote server
+   * @param[in] args Variadic argument list to pass to the remote server
+   * @return Task<R> Task producing the server response
+   */
+  template <typename R = msgpack::object_handle, typename... A>
+  Task<R> co_call(std::string name, A... args);
+
+  /**
+   * @brief Start a new batch of calls to send to the server as one request
+   *
+   * @return Batch Empty batch bound to this client
+   */
+  Batch batch(void);
 };
 
 /**
@@ -269,12 +2028,34 @@ public:
  */
 struct Error
 {
+  /**
+   * @brief Codes distinguishing the kinds of error
+   */
+  enum Code : std::uint32_t
+  {
+    /**
+     * @brief RPC could not be found or failed while executing
+     */
+    failed = 0,
+
+    /**
+     * @brief Server rejected the request without executing it because it is
+     * over its limits; the request may be retried later
+     */
+    overloaded = 1
+  };
+
   /**
    * @brief Error message
    */
   std::string m_msg;
 
-  MSGPACK_DEFINE(m_msg)
+  /**
+   * @brief Kind of error
+   */
+  std::uint32_t m_code{failed};
+
+  MSGPACK_DEFINE(m_msg, m_code)
 };
 
 /**
@@ -302,9 +2083,9 @@ private:
   zmq::socket_t m_pub;
 
   /**
-   * @brief CRC table for use in efficient CRC calculations
+   * @brief Integrity check applied to outgoing payloads
    */
-  CRC::Table<std::uint32_t, 32> m_crcTable;
+  Integrity m_integrity;
 
 public:
   /**
@@ -323,6 +2104,15 @@ public:
    */
   explicit Publisher(const std::string &uri);
 
+  /**
+   * @brief Construct a new zRPC::Publisher object listening on the specified
+   * URI using the given integrity check
+   *
+   * @param[in] uri Zero-MQ address/port URI to bind listening socket to.
+   * @param[in] integrity Integrity check applied to published messages
+   */
+  explicit Publisher(const std::string &uri, const Integrity integrity);
+
   /**
    * @brief Publish a MessagePack-able object using the given topic name
    *
@@ -364,11 +2154,6 @@ private:
    */
   bool m_running{false};
 
-  /**
-   * @brief CRC table for use in efficient CRC calculations
-   */
-  CRC::Table<std::uint32_t, 32> m_crcTable;
-
   /**
    * @brief Subscription handler function
    *
@@ -422,4 +2207,6 @@ public:
 #include "zRPCServer.inl"
 #include "zRPCSubscriber.inl"
 
+#include "zRPCService.hpp"
+
 #endif  // _ZRPC_HPP_
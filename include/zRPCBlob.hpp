@@ -0,0 +1,309 @@
+/*
+ * @file   zRPCBlob.hpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 9:41:08 pm
+ *
+ * @brief Zero-copy binary arguments and results for the zRPC client/server
+ * library
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ZRPC_BLOB_HPP_
+#define _ZRPC_BLOB_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#include <msgpack.hpp>
+#pragma GCC diagnostic pop
+
+namespace zRPC
+{
+/**
+ * @class Blob zRPCBlob.hpp "zRPCBlob.hpp"
+ *
+ * @brief Block of bytes passed to or returned from an RPC without being copied.
+ *
+ * A blob packed into a request or reply travels as a frame of its own after
+ * the payload, which only holds a reference to it. Blobs built from a vector
+ * or string take over its memory, and sending one shares that memory with 0MQ
+ * rather than copying it.
+ *
+ * A blob received as an argument or a result is a view over the received
+ * frame: it is valid until the RPC replies, or for as long as the result
+ * handle is kept on the client. Construct a new blob from its bytes to keep
+ * them for longer.
+ *
+ * Frames are not covered by the header checksum, as checking them would read
+ * every byte that sending them without copying avoids touching.
+ */
+class Blob
+{
+public:
+  /**
+   * @brief MessagePack extension type referring to a frame following the
+   * payload
+   */
+  static constexpr std::int8_t extType = 0x5A;
+
+  /**
+   * @brief Construct a new, empty zRPC::Blob object
+   */
+  Blob(void) = default;
+
+  /**
+   * @brief Construct a new zRPC::Blob object taking over a vector of bytes
+   *
+   * @param[in] bytes Bytes to take over
+   */
+  explicit Blob(std::vector<std::uint8_t> &&bytes);
+
+  /**
+   * @brief Construct a new zRPC::Blob object taking over a string of bytes
+   *
+   * @param[in] bytes Bytes to take over
+   */
+  explicit Blob(std::string &&bytes);
+
+  /**
+   * @brief Construct a new zRPC::Blob object taking over a 0MQ message
+   *
+   * @param[in] msg Message holding the bytes
+   */
+  explicit Blob(zmq::message_t &&msg);
+
+  /**
+   * @brief Construct a new zRPC::Blob object holding a copy of some bytes
+   *
+   * @param[in] data Bytes to copy
+   * @param[in] size Number of bytes to copy
+   */
+  Blob(const void *data, std::size_t size);
+
+  /**
+   * @brief Construct a zRPC::Blob viewing bytes owned elsewhere
+   *
+   * @param[in] data Bytes to view, which must outlive the blob
+   * @param[in] size Number of bytes
+   * @return Blob Blob referring to the bytes
+   */
+  static Blob view(const void *data, std::size_t size);
+
+  /**
+   * @brief Get the bytes of the blob
+   *
+   * @return const std::uint8_t* Bytes of the blob
+   */
+  const std::uint8_t *data(void) const
+  {
+    return m_data;
+  }
+
+  /**
+   * @brief Get the number of bytes of the blob
+   *
+   * @return std::size_t Number of bytes
+   */
+  std::size_t size(void) const
+  {
+    return m_size;
+  }
+
+  /**
+   * @brief Whether the blob holds no bytes
+   */
+  bool empty(void) const
+  {
+    return m_size == 0;
+  }
+
+  /**
+   * @brief Get the bytes of the blob as a span
+   *
+   * @return std::span<const std::uint8_t> Bytes of the blob
+   */
+  std::span<const std::uint8_t> span(void) const
+  {
+    return {m_data, m_size};
+  }
+
+  /**
+   * @brief Build a 0MQ message holding the bytes of the blob, sharing them
+   * when the blob owns them and copying them when it is a view
+   *
+   * @return zmq::message_t Message holding the bytes
+   */
+  zmq::message_t message(void) const;
+
+private:
+  /**
+   * @brief Message owning the bytes, or nullptr for a view
+   */
+  std::shared_ptr<zmq::message_t> m_msg;
+
+  /**
+   * @brief Bytes of the blob
+   */
+  const std::uint8_t *m_data{nullptr};
+
+  /**
+   * @brief Number of bytes of the blob
+   */
+  std::size_t m_size{0};
+};
+
+namespace support
+{
+/**
+ * @class FrameSink zRPCBlob.hpp "zRPCBlob.hpp"
+ *
+ * @brief Collects the frames of the blobs packed on the calling thread while
+ * it is in scope; blobs packed with no sink in scope are packed inline as
+ * binary data instead.
+ */
+class FrameSink
+{
+private:
+  // Delete copy constructor
+  FrameSink(FrameSink const &) = delete;
+
+  /**
+   * @brief Frames collected so far
+   */
+  std::vector<zmq::message_t> &m_frames;
+
+  /**
+   * @brief Sink that was in scope before this one
+   */
+  FrameSink *m_prev;
+
+  /**
+   * @brief Sink in scope on the calling thread
+   */
+  static FrameSink *&current(void)
+  {
+    thread_local FrameSink *sink = nullptr;
+    return sink;
+  }
+
+public:
+  /**
+   * @brief Collect the frames of blobs packed on this thread until destroyed
+   *
+   * @param[out] frames Vector to append the frames to
+   */
+  explicit FrameSink(std::vector<zmq::message_t> &frames) :
+      m_frames(frames), m_prev(current())
+  {
+    current() = this;
+  }
+
+  ~FrameSink()
+  {
+    current() = m_prev;
+  }
+
+  /**
+   * @brief Get the frames of the sink in scope on the calling thread
+   *
+   * @return std::vector<zmq::message_t>* Frames to append to, or nullptr if
+   * no sink is in scope
+   */
+  static std::vector<zmq::message_t> *active(void)
+  {
+    auto sink = current();
+    return sink ? &sink->m_frames : nullptr;
+  }
+};
+
+/**
+ * @brief Replace the references to frames in an unpacked payload with binary
+ * data viewing those frames, in the order they were packed
+ *
+ * @param[in,out] obj Unpacked payload
+ * @param[in] frames Frames received after the payload
+ * @throw std::runtime_error The references do not match the frames
+ */
+void attach(msgpack::object &obj, std::vector<zmq::message_t> &frames);
+}  // namespace support
+}  // namespace zRPC
+
+namespace msgpack
+{
+MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
+{
+  namespace adaptor
+  {
+  template <>
+  struct pack<zRPC::Blob>
+  {
+    template <typename Stream>
+    msgpack::packer<Stream> &operator()(msgpack::packer<Stream> &o,
+                                        const zRPC::Blob &v) const
+    {
+      const auto size = static_cast<std::uint32_t>(v.size());
+      auto frames = zRPC::support::FrameSink::active();
+      if (!frames)
+      {
+        o.pack_bin(size);
+        o.pack_bin_body(reinterpret_cast<const char *>(v.data()), size);
+        return o;
+      }
+
+      // Refer to the frame by its size, which is checked when it is attached
+      frames->emplace_back(v.message());
+      char ref[4];
+      for (std::size_t i = 0; i < sizeof(ref); ++i)
+      {
+        ref[i] = static_cast<char>(size >> (8U * (sizeof(ref) - 1U - i)));
+      }
+      o.pack_ext(sizeof(ref), zRPC::Blob::extType);
+      o.pack_ext_body(ref, sizeof(ref));
+      return o;
+    }
+  };
+
+  template <>
+  struct convert<zRPC::Blob>
+  {
+    msgpack::object const &operator()(msgpack::object const &o,
+                                       zRPC::Blob &v) const
+    {
+      if (o.type != msgpack::type::BIN)
+      {
+        throw msgpack::type_error();
+      }
+      v = zRPC::Blob::view(o.via.bin.ptr, o.via.bin.size);
+      return o;
+    }
+  };
+  }  // namespace adaptor
+}  // MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
+}  // namespace msgpack
+
+#endif  // _ZRPC_BLOB_HPP_
@@ -0,0 +1,240 @@
+/*
+ * @file   zRPCCache.hpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 7:22:45 pm
+ *
+ * @brief Bounded LRU cache with expiry for the zRPC client/server library
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ZRPC_CACHE_HPP_
+#define _ZRPC_CACHE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace zRPC
+{
+/**
+ * @brief Limits of a cache of RPC results
+ */
+struct CachePolicy
+{
+  /**
+   * @brief Maximum number of results kept; 0 disables the cache
+   */
+  std::size_t m_maxEntries{0};
+
+  /**
+   * @brief Maximum number of bytes of keys and results kept; 0 for no limit
+   */
+  std::size_t m_maxBytes{0};
+
+  /**
+   * @brief Time a result is kept for; 0 to keep it until evicted
+   */
+  std::chrono::milliseconds m_ttl{0};
+};
+
+namespace support
+{
+/**
+ * @class LruCache zRPCCache.hpp "zRPCCache.hpp"
+ *
+ * @brief Cache evicting the least recently used entries once it exceeds the
+ * limits of its CachePolicy, and dropping entries older than its TTL.
+ *
+ * The cache is not synchronized; it must be owned by one thread or guarded by
+ * its owner.
+ *
+ * @tparam K Type of the keys, which must be hashable
+ * @tparam V Type of the cached values
+ */
+template <typename K, typename V>
+class LruCache
+{
+public:
+  /**
+   * @brief Clock the entry expiry is measured against
+   */
+  using clock_type = std::chrono::steady_clock;
+
+private:
+  /**
+   * @brief Cached value along with its size, expiry and position in the
+   * recency list
+   */
+  struct Entry
+  {
+    V m_value;
+    std::size_t m_bytes;
+    clock_type::time_point m_expiry;
+    typename std::list<const K *>::iterator m_use;
+  };
+
+  /**
+   * @brief Limits of the cache
+   */
+  CachePolicy m_policy;
+
+  /**
+   * @brief Cached entries, indexed by key
+   */
+  std::unordered_map<K, Entry> m_entries;
+
+  /**
+   * @brief Keys of the cached entries, most recently used first
+   */
+  std::list<const K *> m_uses;
+
+  /**
+   * @brief Number of bytes of keys and values cached
+   */
+  std::size_t m_bytes{0};
+
+  /**
+   * @brief Remove an entry from the cache
+   *
+   * @param[in] it Entry to remove
+   */
+  void erase(typename std::unordered_map<K, Entry>::iterator it)
+  {
+    m_bytes -= it->second.m_bytes;
+    m_uses.erase(it->second.m_use);
+    m_entries.erase(it);
+  }
+
+public:
+  /**
+   * @brief Construct a new, empty zRPC::support::LruCache object
+   *
+   * @param[in] policy Limits of the cache
+   */
+  explicit LruCache(const CachePolicy &policy) : m_policy(policy)
+  {
+  }
+
+  /**
+   * @brief Look up a value, marking it as the most recently used
+   *
+   * @param[in] key Key of the value
+   * @return const V* Cached value, or nullptr if it is not cached or has
+   * expired
+   */
+  const V *find(const K &key)
+  {
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+    {
+      return nullptr;
+    }
+
+    if (clock_type::now() >= it->second.m_expiry)
+    {
+      erase(it);
+      return nullptr;
+    }
+
+    m_uses.splice(m_uses.begin(), m_uses, it->second.m_use);
+    return &it->second.m_value;
+  }
+
+  /**
+   * @brief Cache a value, replacing any value cached under the same key and
+   * evicting the least recently used values until the cache is within its
+   * limits
+   *
+   * @param[in] key Key of the value
+   * @param[in] value Value to cache
+   * @param[in] bytes Size of the entry in bytes, counted against the byte
+   * limit
+   */
+  void insert(K key, V value, std::size_t bytes)
+  {
+    if (m_policy.m_maxEntries == 0)
+    {
+      return;
+    }
+
+    auto existing = m_entries.find(key);
+    if (existing != m_entries.end())
+    {
+      erase(existing);
+    }
+
+    const auto expiry = (m_policy.m_ttl.count() > 0)
+                            ? clock_type::now() + m_policy.m_ttl
+                            : clock_type::time_point::max();
+    auto [it, inserted] = m_entries.emplace(
+        std::move(key), Entry{std::move(value), bytes, expiry, {}});
+    (void)inserted;
+    m_uses.push_front(&it->first);
+    it->second.m_use = m_uses.begin();
+    m_bytes += bytes;
+
+    while ((m_entries.size() > m_policy.m_maxEntries) ||
+           ((m_policy.m_maxBytes > 0) && (m_bytes > m_policy.m_maxBytes)))
+    {
+      erase(m_entries.find(*m_uses.back()));
+    }
+  }
+
+  /**
+   * @brief Remove a value from the cache
+   *
+   * @param[in] key Key of the value
+   */
+  void remove(const K &key)
+  {
+    auto it = m_entries.find(key);
+    if (it != m_entries.end())
+    {
+      erase(it);
+    }
+  }
+
+  /**
+   * @brief Remove all values from the cache
+   */
+  void clear(void)
+  {
+    m_entries.clear();
+    m_uses.clear();
+    m_bytes = 0;
+  }
+
+  /**
+   * @brief Get the number of values cached
+   *
+   * @return std::size_t Number of values cached
+   */
+  std::size_t size(void) const
+  {
+    return m_entries.size();
+  }
+};
+}  // namespace support
+}  // namespace zRPC
+
+#endif  // _ZRPC_CACHE_HPP_
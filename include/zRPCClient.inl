@@ -30,62 +30,195 @@
 namespace zRPC
 {
 template <typename... A>
-msgpack::object_handle Client::call(const std::string &name, A... args)
+msgpack::object_handle Client::call(const std::string &name, A &&...args)
 {
-  return call(-1, name, args...);
+  return call(-1, name, std::forward<A>(args)...);
 }
 
 template <typename... A>
 msgpack::object_handle Client::call(int timeout,
                                     const std::string &name,
-                                    A... args)
+                                    A &&...args)
 {
-  try
+  Header hdr;
+  return request(timeout, hdr, name, args...);
+}
+
+template <typename... A>
+msgpack::object_handle Client::request(const int timeout,
+                                       Header &hdr,
+                                       const std::string &name,
+                                       const A &...args)
+{
+  const auto start = std::chrono::steady_clock::now();
+  if (!m_described)
+  {
+    (void)describe(timeout);
+  }
+
+  hdr.m_id = m_reqId++;
+  hdr.m_method = method(name);
+  const Header sent = hdr;
+  auto &sbuf = support::scratch();
+  std::vector<zmq::message_t> frames;
+  pack(hdr, sbuf, frames, name, args...);
+
+  std::string key;
+  std::uint64_t epoch = 0;
+  msgpack::object_handle res;
+  // Blobs are not part of the payload, so calls passing them are never cached
+  if (m_caching && frames.empty() && lookup(name, sbuf, key, epoch, res))
   {
-    // Ensure socket is connected to the server
-    zmq::socket_t l_sock(m_ctx, zmq::socket_type::dealer);
-    l_sock.set(zmq::sockopt::rcvtimeo, timeout);
-    // Clean out the memory after the socket is closed
-    l_sock.set(zmq::sockopt::linger, timeout);
-    l_sock.set(zmq::sockopt::routing_id, m_idBase + std::to_string(m_idx++));
-    l_sock.connect(m_uri);
-
-    // Create a tuple with the RPC name and arguments
-    auto args_tuple = std::make_tuple(args...);
-    auto call_tuple = std::make_tuple(name, args_tuple);
-
-    // Pack the tuple into a stringstream and calculate CRC
-    std::stringstream cbuf;
-    msgpack::pack(cbuf, call_tuple);
-    std::uint32_t crc =
-        CRC::Calculate(cbuf.str().data(), cbuf.str().size(), m_crcTable);
-    auto crc_tuple = std::make_tuple(cbuf.str(), crc);
-
-    // Pack the new tuple into an object and send to the server
-    auto sbuf = std::make_shared<msgpack::sbuffer>();
-    msgpack::pack(*sbuf, crc_tuple);
-    (void)l_sock.send(zmq::const_buffer(sbuf->data(), sbuf->size()));
-
-    // Wait for response or timeout event
-
-    zmq::message_t msg;
-    auto rxres = l_sock.recv(msg);
-    if (rxres && (rxres.value() > 0))
-    {
-      auto obj = msgpack::unpack(static_cast<char *>(msg.data()), msg.size());
-      return obj;
-    }
-    else
-    {
-      std::cout << " ! ZMQ Warning server is not responding, request <" << name
-                << "> is dropped !" << std::endl;
-    }
+    return res;
   }
-  catch (const zmq::error_t &e)
+
+  // Give up without sending the call if describing the server used up its
+  // timeout
+  auto left = remaining(timeout, start);
+  if ((timeout > 0) && (left == 0))
   {
-    std::cerr << " !! ZMQ Error " << e.num() << ": " << e.what() << std::endl;
+    std::cout << " ! ZMQ Warning server is not responding, request <" << name
+              << "> is dropped !" << std::endl;
+    return res;
   }
 
-  return msgpack::object_handle();
+  res = exchange(left, hdr, sbuf, frames, name);
+  left = remaining(timeout, start);
+  if ((hdr.m_flags & Header::stale) && (sent.m_method != 0) &&
+      ((timeout <= 0) || (left > 0)))
+  {
+    // The server changed its RPCs since it was described and did not run the
+    // call, so send it again by name with what is left of the timeout; the
+    // next call describes the server again
+    hdr = sent;
+    hdr.m_id = m_reqId++;
+    hdr.m_method = 0;
+    auto &retry = support::scratch();
+    frames.clear();
+    pack(hdr, retry, frames, name, args...);
+    res = exchange(left, hdr, retry, frames, name);
+  }
+
+  if (!key.empty() && !(hdr.m_flags & Header::error))
+  {
+    store(name, std::move(key), epoch, res);
+  }
+  return res;
+}
+
+template <typename... A>
+void Client::notify(const std::string &name, A &&...args)
+{
+  Header hdr;
+  hdr.m_id = m_reqId++;
+  hdr.m_flags = Header::oneway;
+  // No reply could tell that a method id is stale, so always go by name
+  auto &sbuf = support::scratch();
+  std::vector<zmq::message_t> frames;
+  pack(hdr, sbuf, frames, name, args...);
+  post(hdr, sbuf, frames);
+}
+
+template <typename... A>
+std::future<msgpack::object_handle> Client::async_call(const std::string &name,
+                                                       A &&...args)
+{
+  auto prom = std::make_shared<std::promise<msgpack::object_handle>>();
+  auto fut = prom->get_future();
+  async_call([prom](msgpack::object_handle &res)
+             { prom->set_value(std::move(res)); },
+             name, std::forward<A>(args)...);
+  return fut;
+}
+
+template <typename... A>
+std::uint64_t Client::async_call(cb_type cb,
+                                 const std::string &name,
+                                 A &&...args)
+{
+  Header hdr;
+  hdr.m_id = m_reqId++;
+  hdr.m_method = method(name);
+  auto &sbuf = support::scratch();
+  std::vector<zmq::message_t> frames;
+  pack(hdr, sbuf, frames, name, args...);
+  dispatch(hdr, std::move(cb), sbuf, frames, name);
+  return hdr.m_id;
+}
+
+template <typename R, typename... A>
+Task<R> Client::co_call(std::string name, A... args)
+{
+  // The request is sent before the coroutine suspends, so the buffer is not
+  // needed once the awaiter is resumed
+  Header hdr;
+  hdr.m_id = m_reqId++;
+  hdr.m_method = method(name);
+  auto &sbuf = support::scratch();
+  std::vector<zmq::message_t> frames;
+  pack(hdr, sbuf, frames, name, args...);
+  auto res = co_await ReplyAwaiter{*this, hdr, sbuf, frames, name, {}};
+
+  if constexpr (std::is_void_v<R>)
+  {
+    (void)res;
+  }
+  else if constexpr (std::is_same_v<R, msgpack::object_handle>)
+  {
+    co_return res;
+  }
+  else
+  {
+    co_return decode<R>(res.get());
+  }
+}
+
+template <typename... A>
+void Client::pack(const Header &hdr,
+                  msgpack::sbuffer &sbuf,
+                  std::vector<zmq::message_t> &frames,
+                  const std::string &name,
+                  const A &...args)
+{
+  // Pack each argument directly into the request payload with the codec of its
+  // type, prefixed by the RPC name only when the header does not carry its
+  // method id, and collect the blobs among them to send as frames of their own
+  support::FrameSink sink(frames);
+  msgpack::packer<msgpack::sbuffer> pk(sbuf);
+  if (hdr.m_method == 0)
+  {
+    pk.pack_array(2);
+    pk.pack(name);
+  }
+  support::encodeArgs(pk, args...);
+}
+
+template <typename... A>
+Client::Batch &Client::Batch::add(const std::string &name, const A &...args)
+{
+  // Append the call; the array header is written when the batch is sent
+  support::FrameSink sink(m_frames);
+  msgpack::packer<msgpack::sbuffer> pk(m_calls);
+  pk.pack_array(2);
+  const auto id = m_client.method(name);
+  if (id != 0)
+  {
+    pk.pack(id);
+  }
+  else
+  {
+    pk.pack(name);
+  }
+
+  const auto begin = m_calls.size();
+  const auto firstFrame = m_frames.size();
+  support::encodeArgs(pk, args...);
+  if (id != 0)
+  {
+    m_byId.push_back(
+        {m_count, name, begin, m_calls.size(), firstFrame, m_frames.size()});
+  }
+  ++m_count;
+  return *this;
 }
 }  // namespace zRPC
\ No newline at end of file
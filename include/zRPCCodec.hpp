@@ -0,0 +1,327 @@
+/*
+ * @file   zRPCCodec.hpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 11:08:19 pm
+ *
+ * @brief Per-type encodings of arguments and results for the zRPC
+ * client/server library
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ZRPC_CODEC_HPP_
+#define _ZRPC_CODEC_HPP_
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#include <msgpack.hpp>
+#pragma GCC diagnostic pop
+
+namespace zRPC
+{
+/**
+ * @brief Encoding of values as their MessagePack representation, used unless
+ * a type chooses another codec
+ *
+ * @tparam T Type of the values
+ */
+template <typename T>
+struct MsgpackCodec
+{
+  template <typename Stream>
+  static void pack(msgpack::packer<Stream> &pk, const T &value)
+  {
+    pk.pack(value);
+  }
+
+  static T unpack(msgpack::object const &o)
+  {
+    return o.as<T>();
+  }
+};
+
+/**
+ * @brief Layout of values encoded by RawCodec
+ *
+ * Raw values travel as a MessagePack extension holding their bytes in the
+ * order of the host that packed them. The extension type names that byte
+ * order, so a value packed on a host of the other order is rejected rather
+ * than misread. Servers also report their byte order to `zrpc.describe`, but
+ * only as advice: a client of the other order is warned, and it is still the
+ * decoding of each raw value that fails.
+ */
+struct RawFormat
+{
+  static_assert((std::endian::native == std::endian::little) ||
+                    (std::endian::native == std::endian::big),
+                "Raw values need a little- or big-endian host");
+
+  /**
+   * @brief MessagePack extension type of values packed little-endian
+   */
+  static constexpr std::int8_t littleEndian = 0x5B;
+
+  /**
+   * @brief MessagePack extension type of values packed big-endian
+   */
+  static constexpr std::int8_t bigEndian = 0x5C;
+
+  /**
+   * @brief MessagePack extension type of values packed on this host
+   */
+  static constexpr std::int8_t native =
+      (std::endian::native == std::endian::little) ? littleEndian : bigEndian;
+
+  /**
+   * @brief Pack bytes as a raw value
+   *
+   * @tparam Stream Type of stream written by the packer
+   * @param[in] pk Packer to write to
+   * @param[in] data Bytes of the value
+   * @param[in] size Number of bytes
+   * @throw std::runtime_error Value is too large for a MessagePack extension
+   */
+  template <typename Stream>
+  static void pack(msgpack::packer<Stream> &pk,
+                   const void *data,
+                   std::size_t size)
+  {
+    if (size > std::numeric_limits<std::uint32_t>::max())
+    {
+      throw std::runtime_error("Raw value of " + std::to_string(size) +
+                               " bytes is too large to pack");
+    }
+
+    const auto len = static_cast<std::uint32_t>(size);
+    pk.pack_ext(len, native);
+    pk.pack_ext_body(static_cast<const char *>(data), len);
+  }
+
+  /**
+   * @brief Whether an object holds a raw value
+   *
+   * @param[in] o Object to check
+   * @return true Object is a raw value of either byte order
+   */
+  static bool holds(msgpack::object const &o)
+  {
+    return (o.type == msgpack::type::EXT) &&
+           ((o.via.ext.type() == littleEndian) ||
+            (o.via.ext.type() == bigEndian));
+  }
+
+  /**
+   * @brief Get the bytes of a raw value packed on a host of this byte order
+   *
+   * @param[in] o Object holding the value
+   * @return std::span<const char> Bytes of the value
+   * @throw msgpack::type_error Object is not a raw value
+   * @throw std::runtime_error Value was packed in the other byte order
+   */
+  static std::span<const char> bytes(msgpack::object const &o)
+  {
+    if (!holds(o))
+    {
+      throw msgpack::type_error();
+    }
+    if (o.via.ext.type() != native)
+    {
+      throw std::runtime_error(
+          "Raw value was packed on a host of the other byte order");
+    }
+    return {o.via.ext.data(), o.via.ext.size};
+  }
+};
+
+/**
+ * @brief Encoding of values as a copy of their bytes, for trivially copyable
+ * types with a fixed layout shared by both ends
+ *
+ * A value is packed and unpacked with a single copy, instead of field by field.
+ * Both ends must agree on the layout of the type, which includes its padding.
+ * Pointers held by the type would be sent as addresses, meaningless to the
+ * other end; only a bare pointer type is rejected, so keeping them out of the
+ * members is up to the caller.
+ *
+ * @tparam T Type of the values
+ */
+template <typename T>
+struct RawCodec
+{
+  static_assert(std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>,
+                "Raw values must be trivially copyable and not pointers");
+
+  template <typename Stream>
+  static void pack(msgpack::packer<Stream> &pk, const T &value)
+  {
+    RawFormat::pack(pk, &value, sizeof(T));
+  }
+
+  static T unpack(msgpack::object const &o)
+  {
+    const auto bytes = RawFormat::bytes(o);
+    if (bytes.size() != sizeof(T))
+    {
+      throw msgpack::type_error();
+    }
+
+    // Build the value from its bytes, so that T need not be default
+    // constructible
+    std::array<char, sizeof(T)> raw;
+    std::memcpy(raw.data(), bytes.data(), sizeof(T));
+    return std::bit_cast<T>(raw);
+  }
+};
+
+/**
+ * @brief Encoding of vectors of trivially copyable elements, such as numbers,
+ * as a copy of all their elements at once
+ *
+ * @tparam T Type of the elements
+ * @tparam Alloc Allocator of the vector
+ */
+template <typename T, typename Alloc>
+struct RawCodec<std::vector<T, Alloc>>
+{
+  static_assert(std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>,
+                "Raw elements must be trivially copyable and not pointers");
+  static_assert(std::is_default_constructible_v<T>,
+                "Raw elements must be default constructible to fill a vector");
+
+  template <typename Stream>
+  static void pack(msgpack::packer<Stream> &pk,
+                   const std::vector<T, Alloc> &value)
+  {
+    RawFormat::pack(pk, value.data(), sizeof(T) * value.size());
+  }
+
+  static std::vector<T, Alloc> unpack(msgpack::object const &o)
+  {
+    const auto bytes = RawFormat::bytes(o);
+    if ((bytes.size() % sizeof(T)) != 0)
+    {
+      throw msgpack::type_error();
+    }
+
+    std::vector<T, Alloc> value(bytes.size() / sizeof(T));
+    std::memcpy(value.data(), bytes.data(), bytes.size());
+    return value;
+  }
+};
+
+/**
+ * @brief Codec encoding the arguments and results of type T
+ *
+ * Every type is encoded through MessagePack unless this trait is specialized
+ * for it, which must be done alike on both ends and before the type is used in
+ * an RPC. Deriving the specialization from RawCodec copies the bytes of the
+ * value instead:
+ * @code
+ * template <>
+ * struct zRPC::Codec<Vec3> : zRPC::RawCodec<Vec3>
+ * {
+ * };
+ * template <>
+ * struct zRPC::Codec<std::vector<double>> : zRPC::RawCodec<std::vector<double>>
+ * {
+ * };
+ * @endcode
+ *
+ * Other formats plug in the same way, with a specialization providing
+ * `pack(msgpack::packer<Stream> &, const T &)` and
+ * `T unpack(msgpack::object const &)`; binary and extension objects carry
+ * bytes encoded in any format. Codecs apply to the arguments and results of
+ * RPCs, not to the members of a MessagePack-encoded type.
+ *
+ * @tparam T Type of the values
+ */
+template <typename T>
+struct Codec : MsgpackCodec<T>
+{
+};
+
+/**
+ * @brief Decode a result or argument encoded with the codec of its type
+ *
+ * Results of types using a codec other than MessagePack must be decoded with
+ * this rather than `msgpack::object::as`.
+ *
+ * @tparam T Type of the value
+ * @param[in] o Object holding the value
+ * @return T Decoded value
+ */
+template <typename T>
+T decode(msgpack::object const &o)
+{
+  return Codec<T>::unpack(o);
+}
+
+namespace support
+{
+/**
+ * @brief Pack a value with the codec of its type
+ *
+ * @tparam Stream Type of stream written by the packer
+ * @tparam T Type of the value
+ * @param[in] pk Packer to write to
+ * @param[in] value Value to pack
+ */
+template <typename Stream, typename T>
+void encode(msgpack::packer<Stream> &pk, const T &value)
+{
+  if constexpr (std::is_array_v<T>)
+  {
+    pk.pack(value);
+  }
+  else
+  {
+    Codec<T>::pack(pk, value);
+  }
+}
+
+/**
+ * @brief Pack arguments as an array, each with the codec of its type
+ *
+ * @tparam Stream Type of stream written by the packer
+ * @tparam A Types of the arguments
+ * @param[in] pk Packer to write to
+ * @param[in] args Arguments to pack
+ */
+template <typename Stream, typename... A>
+void encodeArgs(msgpack::packer<Stream> &pk, const A &...args)
+{
+  pk.pack_array(static_cast<std::uint32_t>(sizeof...(A)));
+  (encode(pk, args), ...);
+}
+}  // namespace support
+}  // namespace zRPC
+
+#endif  // _ZRPC_CODEC_HPP_
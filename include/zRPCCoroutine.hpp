@@ -0,0 +1,516 @@
+/*
+ * @file   zRPCCoroutine.hpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 9:12:40 am
+ *
+ * @brief C++20 coroutine support for the zRPC client/server library
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ZRPC_COROUTINE_HPP_
+#define _ZRPC_COROUTINE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace zRPC
+{
+template <typename T = void>
+class Task;
+
+namespace support
+{
+/**
+ * @brief Promise state shared by all task types: the coroutine to resume when
+ * the task completes and any exception thrown by the task body
+ */
+struct TaskPromiseBase
+{
+  std::coroutine_handle<> m_continuation{std::noop_coroutine()};
+  std::exception_ptr m_error;
+
+  /**
+   * @brief Transfer control back to the awaiting coroutine on completion
+   */
+  struct FinalAwaiter
+  {
+    bool await_ready() noexcept
+    {
+      return false;
+    }
+
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+    {
+      return h.promise().m_continuation;
+    }
+
+    void await_resume() noexcept
+    {
+    }
+  };
+
+  std::suspend_always initial_suspend() noexcept
+  {
+    return {};
+  }
+
+  FinalAwaiter final_suspend() noexcept
+  {
+    return {};
+  }
+
+  void unhandled_exception() noexcept
+  {
+    m_error = std::current_exception();
+  }
+};
+
+/**
+ * @brief Promise type of a task returning a value
+ *
+ * @tparam T Type of value returned by the task
+ */
+template <typename T>
+struct TaskPromise : TaskPromiseBase
+{
+  std::optional<T> m_value;
+
+  Task<T> get_return_object() noexcept;
+
+  template <typename V>
+  void return_value(V &&value)
+  {
+    m_value.emplace(std::forward<V>(value));
+  }
+
+  T result()
+  {
+    if (m_error)
+    {
+      std::rethrow_exception(m_error);
+    }
+    return std::move(*m_value);
+  }
+};
+
+/**
+ * @brief Promise type of a task returning nothing
+ */
+template <>
+struct TaskPromise<void> : TaskPromiseBase
+{
+  Task<void> get_return_object() noexcept;
+
+  void return_void() noexcept
+  {
+  }
+
+  void result()
+  {
+    if (m_error)
+    {
+      std::rethrow_exception(m_error);
+    }
+  }
+};
+
+/**
+ * @brief Eagerly started coroutine that destroys itself on completion, used to
+ * drive tasks from non-coroutine code
+ */
+struct Detached
+{
+  struct promise_type
+  {
+    Detached get_return_object() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never final_suspend() noexcept
+    {
+      return {};
+    }
+
+    void return_void() noexcept
+    {
+    }
+
+    void unhandled_exception() noexcept
+    {
+      std::terminate();
+    }
+  };
+};
+
+/**
+ * @brief Define type to detect callables returning a zRPC::Task
+ */
+template <typename T>
+struct task_traits : std::false_type
+{
+};
+template <typename R>
+struct task_traits<Task<R>> : std::true_type
+{
+  using value_type = R;
+};
+
+}  // namespace support
+
+/**
+ * @class Task zRPCCoroutine.hpp "zRPCCoroutine.hpp"
+ *
+ * @brief Lazily started coroutine producing a value of type T.
+ *
+ * The task body does not run until the task is awaited with `co_await` or
+ * driven to completion with `zRPC::sync_wait`. Exceptions thrown by the body
+ * are rethrown to the awaiting coroutine.
+ *
+ * @tparam T Type of value returned by the task
+ */
+template <typename T>
+class Task
+{
+public:
+  using promise_type = support::TaskPromise<T>;
+
+  explicit Task(std::coroutine_handle<promise_type> h) noexcept : m_handle(h)
+  {
+  }
+
+  Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, {}))
+  {
+  }
+
+  Task &operator=(Task &&other) noexcept
+  {
+    if (this != &other)
+    {
+      if (m_handle)
+      {
+        m_handle.destroy();
+      }
+      m_handle = std::exchange(other.m_handle, {});
+    }
+    return *this;
+  }
+
+  ~Task()
+  {
+    if (m_handle)
+    {
+      m_handle.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept
+  {
+    return !m_handle || m_handle.done();
+  }
+
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<> continuation) noexcept
+  {
+    m_handle.promise().m_continuation = continuation;
+    return m_handle;
+  }
+
+  T await_resume()
+  {
+    return m_handle.promise().result();
+  }
+
+private:
+  // Delete copy constructor
+  Task(Task const &) = delete;
+
+  /**
+   * @brief Handle of the coroutine owned by the task
+   */
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+template <typename T>
+Task<T> support::TaskPromise<T>::get_return_object() noexcept
+{
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> support::TaskPromise<void>::get_return_object() noexcept
+{
+  return Task<void>(
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief Run a task to completion, blocking the calling thread until it is done
+ *
+ * @tparam T Type of value returned by the task
+ * @param[in] task Task to run
+ * @return T Value returned by the task
+ */
+template <typename T>
+T sync_wait(Task<T> task)
+{
+  std::promise<T> prom;
+  auto fut = prom.get_future();
+  [](Task<T> t, std::promise<T> &p) -> support::Detached
+  {
+    try
+    {
+      if constexpr (std::is_void_v<T>)
+      {
+        co_await t;
+        p.set_value();
+      }
+      else
+      {
+        p.set_value(co_await t);
+      }
+    }
+    catch (...)
+    {
+      p.set_exception(std::current_exception());
+    }
+  }(std::move(task), prom);
+  return fut.get();
+}
+
+/**
+ * @brief Run a set of tasks concurrently and collect their results in order
+ *
+ * All tasks are started at once, so any RPCs they issue are in flight at the
+ * same time. The first exception thrown by any task is rethrown once all of
+ * them have completed.
+ *
+ * @tparam T Type of value returned by each task
+ * @param[in] tasks Tasks to run
+ * @return Task<std::vector<T>> Task producing the results of all tasks
+ */
+template <typename T>
+Task<std::vector<T>> when_all(std::vector<Task<T>> tasks)
+{
+  struct State
+  {
+    std::vector<std::optional<T>> m_results;
+    std::exception_ptr m_error;
+    std::mutex m_mtx;
+    std::atomic<std::size_t> m_remaining;
+    std::coroutine_handle<> m_continuation;
+  };
+
+  struct Awaiter
+  {
+    std::vector<Task<T>> &m_tasks;
+    State &m_state;
+
+    bool await_ready() const noexcept
+    {
+      return m_tasks.empty();
+    }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+      m_state.m_continuation = h;
+      for (std::size_t i = 0; i < m_tasks.size(); ++i)
+      {
+        [](Task<T> &t, State &s, std::size_t idx) -> support::Detached
+        {
+          try
+          {
+            s.m_results[idx].emplace(co_await t);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> lock(s.m_mtx);
+            if (!s.m_error)
+            {
+              s.m_error = std::current_exception();
+            }
+          }
+
+          // The last task to complete resumes the awaiting coroutine
+          if (s.m_remaining.fetch_sub(1) == 1)
+          {
+            s.m_continuation.resume();
+          }
+        }(m_tasks[i], m_state, i);
+      }
+
+      // Tasks may all have completed while being started, in which case the
+      // awaiting coroutine continues without suspending
+      return m_state.m_remaining.fetch_sub(1) != 1;
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+  };
+
+  State state;
+  state.m_results.resize(tasks.size());
+  state.m_remaining = tasks.size() + 1;
+  co_await Awaiter{tasks, state};
+
+  if (state.m_error)
+  {
+    std::rethrow_exception(state.m_error);
+  }
+
+  std::vector<T> results;
+  results.reserve(state.m_results.size());
+  for (auto &r : state.m_results)
+  {
+    results.emplace_back(std::move(*r));
+  }
+  co_return results;
+}
+
+/**
+ * @class Executor zRPCCoroutine.hpp "zRPCCoroutine.hpp"
+ *
+ * @brief Small thread pool that resumes coroutines.
+ *
+ * Coroutines suspended on a `Client::co_call` made from one of the executor
+ * threads are resumed on the executor once the reply arrives, so any number of
+ * RPC conversations can be multiplexed over a handful of threads.
+ */
+class Executor
+{
+private:
+  // Delete copy constructor
+  Executor(Executor const &) = delete;
+
+  /**
+   * @brief Mutex protecting the run queue
+   */
+  std::mutex m_mtx;
+
+  /**
+   * @brief Condition signalled when work is queued or the executor stops
+   */
+  std::condition_variable m_cv;
+
+  /**
+   * @brief Queue of coroutines ready to be resumed
+   */
+  std::deque<std::coroutine_handle<>> m_queue;
+
+  /**
+   * @brief Vector of thread handlers for the executor threads
+   */
+  std::vector<std::thread> m_th;
+
+  /**
+   * @brief Flag indicating that the executor is currently running
+   */
+  bool m_running{true};
+
+  /**
+   * @brief Executor thread function
+   */
+  void worker(void);
+
+public:
+  /**
+   * @brief Construct a new zRPC::Executor object with the specified number of
+   * threads
+   *
+   * @param[in] nThreads Number of threads to create, default = 4
+   */
+  explicit Executor(const uint32_t nThreads = 4U);
+
+  /**
+   * @brief Stop the executor once all queued coroutines have run and join its
+   * threads
+   */
+  ~Executor();
+
+  /**
+   * @brief Queue a suspended coroutine to be resumed on the executor
+   *
+   * @param[in] h Handle of the coroutine to resume
+   */
+  void post(std::coroutine_handle<> h);
+
+  /**
+   * @brief Return an awaitable that moves the awaiting coroutine onto the
+   * executor
+   */
+  auto schedule(void)
+  {
+    struct Awaiter
+    {
+      Executor &m_ex;
+
+      bool await_ready() const noexcept
+      {
+        return false;
+      }
+
+      void await_suspend(std::coroutine_handle<> h)
+      {
+        m_ex.post(h);
+      }
+
+      void await_resume() const noexcept
+      {
+      }
+    };
+    return Awaiter{*this};
+  }
+
+  /**
+   * @brief Start a task on the executor without waiting for it
+   *
+   * Any exception escaping the task is reported and discarded.
+   *
+   * @param[in] task Task to start
+   */
+  void spawn(Task<void> task);
+
+  /**
+   * @brief Get the executor running on the calling thread, if any
+   *
+   * @return Executor* Executor owning the calling thread, or nullptr
+   */
+  static Executor *current(void);
+};
+}  // namespace zRPC
+
+#endif  // _ZRPC_COROUTINE_HPP_
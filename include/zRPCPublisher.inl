@@ -35,20 +35,19 @@ void Publisher::publish(const std::string &topic, T &data)
   {
     if (m_pub)
     {
-      // Pack the data into a stringstream and calculate CRC
-      std::stringstream cbuf;
-      msgpack::pack(cbuf, data);
-      std::uint32_t crc =
-          CRC::Calculate(cbuf.str().data(), cbuf.str().size(), m_crcTable);
+      // Pack the data directly into the payload and calculate its checksum
+      msgpack::sbuffer sbuf;
+      msgpack::packer<msgpack::sbuffer> pk(sbuf);
+      support::encode(pk, data);
+      Header hdr;
+      hdr.m_integrity = m_integrity;
+      hdr.m_checksum = hdr.checksum(sbuf.data(), sbuf.size());
 
-      // Create a tuple with the topic name, packed data, and CRC
-      auto data_tuple = std::make_tuple(topic, cbuf.str(), crc);
-
-      // Pack the new tuple into an object and send to the server
-      auto sbuf = std::make_shared<msgpack::sbuffer>();
-      msgpack::pack(*sbuf, data_tuple);
-      const auto sndbuf = topic + ":" + std::string(sbuf->data(), sbuf->size());
-      (void)m_pub.send(zmq::const_buffer(sndbuf.c_str(), sndbuf.length()));
+      // Send the topic, header and payload as a single multipart message
+      (void)m_pub.send(zmq::const_buffer(topic.data(), topic.size()),
+                       zmq::send_flags::sndmore);
+      (void)m_pub.send(hdr.encode(), zmq::send_flags::sndmore);
+      (void)m_pub.send(support::message(sbuf), zmq::send_flags::none);
     }
   }
   catch (const zmq::error_t &e)
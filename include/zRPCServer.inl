@@ -27,22 +27,314 @@
 
 namespace zRPC
 {
+namespace support
+{
+/**
+ * @brief Ensure that an RPC was called with the expected number of arguments
+ *
+ * @param name Name of the RPC
+ * @param args MsgPack array of arguments to the RPC
+ * @param expected_args Number of arguments the bound function takes
+ */
+inline void checkArgs(const std::string &name,
+                      msgpack::object const &args,
+                      std::size_t expected_args)
+{
+  if (args.type != msgpack::type::ARRAY)
+  {
+    throw std::runtime_error("Function " + name +
+                             " called without an array of arguments");
+  }
+
+  auto called_args = args.via.array.size;
+  if (called_args != expected_args)
+  {
+    throw std::runtime_error(
+        "Function " + name + " called with " + std::to_string(called_args) +
+        " arguments; expected " + std::to_string(expected_args));
+  }
+}
+
+/**
+ * @brief Decode an argument into the type of the parameter it is passed to
+ *
+ * Arguments are decoded by the codec of their type, which for MessagePack
+ * converts them with their adaptor; this includes `std::string_view`,
+ * `msgpack::type::raw_ref` and zRPC::Blob, which view the request rather than
+ * copy out of it.
+ *
+ * @tparam T Type of the parameter
+ */
+template <typename T>
+struct decoder
+{
+  static T get(msgpack::object const &o)
+  {
+    return Codec<T>::unpack(o);
+  }
+};
+
+/**
+ * @brief Decode an argument into a span over its elements
+ *
+ * Spans of single bytes view binary data or strings in the request in place,
+ * as do spans of trivially copyable elements sent with RawCodec when their
+ * bytes are suitably aligned. Other arrays are converted or copied into memory
+ * taken from the decoding zone of the server thread, so that no allocation is
+ * made once the zone has grown to fit. Either way the span is only valid until
+ * the bound function returns, so only functions replying before they return
+ * may take one.
+ *
+ * @tparam T Type of the elements
+ */
+template <typename T>
+struct decoder<std::span<const T>>
+{
+  static_assert(std::is_trivially_destructible_v<T>,
+                "Spans of arguments only hold trivially destructible types");
+
+  static std::span<const T> get(msgpack::object const &o)
+  {
+    if constexpr ((sizeof(T) == 1) &&
+                  (std::is_integral_v<T> || std::is_same_v<T, std::byte>))
+    {
+      if (o.type == msgpack::type::BIN)
+      {
+        return {reinterpret_cast<const T *>(o.via.bin.ptr), o.via.bin.size};
+      }
+      if (o.type == msgpack::type::STR)
+      {
+        return {reinterpret_cast<const T *>(o.via.str.ptr), o.via.str.size};
+      }
+    }
+
+    if constexpr (std::is_trivially_copyable_v<T>)
+    {
+      if (RawFormat::holds(o))
+      {
+        const auto bytes = RawFormat::bytes(o);
+        if ((bytes.size() % sizeof(T)) != 0)
+        {
+          throw msgpack::type_error();
+        }
+
+        const auto size = bytes.size() / sizeof(T);
+        auto items = reinterpret_cast<const T *>(bytes.data());
+        if ((reinterpret_cast<std::uintptr_t>(items) % alignof(T)) != 0)
+        {
+          auto copy = arena().allocate_align(bytes.size(), alignof(T));
+          std::memcpy(copy, bytes.data(), bytes.size());
+          items = static_cast<const T *>(copy);
+        }
+        return {items, size};
+      }
+    }
+
+    if (o.type != msgpack::type::ARRAY)
+    {
+      throw msgpack::type_error();
+    }
+
+    const auto size = o.via.array.size;
+    auto items = static_cast<T *>(
+        arena().allocate_align(sizeof(T) * size, alignof(T)));
+    for (std::uint32_t i = 0; i < size; ++i)
+    {
+      new (&items[i]) T(o.via.array.ptr[i].as<T>());
+    }
+    return {items, size};
+  }
+};
+
+/**
+ * @brief Define type to detect parameter types that view the request or the
+ * decoding zone of the server thread rather than hold their own value
+ */
+template <typename T>
+struct is_view : std::false_type
+{
+};
+template <>
+struct is_view<std::string_view> : std::true_type
+{
+};
+template <>
+struct is_view<msgpack::type::raw_ref> : std::true_type
+{
+};
+template <>
+struct is_view<msgpack::object> : std::true_type
+{
+};
+template <typename T>
+struct is_view<std::span<const T>> : std::true_type
+{
+};
+
+/**
+ * @brief Define type to detect parameters, or tuples of them, among which is a
+ * view
+ */
+template <typename T>
+struct holdsViews : is_view<T>
+{
+};
+template <typename... A>
+struct holdsViews<std::tuple<A...>> : std::disjunction<is_view<A>...>
+{
+};
+
+/**
+ * @brief Pass a decoded argument to a parameter, moving it unless the
+ * parameter is a non-const lvalue reference
+ *
+ * @tparam P Type of the parameter
+ * @tparam T Type of the decoded argument
+ * @param value Decoded argument
+ * @return decltype(auto) Reference to the argument to pass
+ */
+template <typename P, typename T>
+decltype(auto) pass(T &value)
+{
+  if constexpr (std::is_lvalue_reference_v<P> &&
+                !std::is_const_v<std::remove_reference_t<P>>)
+  {
+    return (value);
+  }
+  else
+  {
+    return std::move(value);
+  }
+}
+
+/**
+ * @brief Decode the arguments of an RPC into a tuple of parameter types
+ *
+ * @tparam Args Decayed types of the parameters
+ * @tparam I Index sequence into the arguments
+ * @param args MsgPack array of arguments, already checked to be long enough
+ * @return std::tuple<Args...> Decoded arguments
+ */
+template <typename... Args, std::size_t... I>
+std::tuple<Args...> decodeArgs_detail(msgpack::object const &args,
+                                      std::tuple<Args...> *,
+                                      std::index_sequence<I...>)
+{
+  return {decoder<Args>::get(args.via.array.ptr[I])...};
+}
+
+/**
+ * @brief Decode the arguments of an RPC, each with the codec of its type
+ *
+ * @tparam T std::tuple of the decayed types of the parameters
+ * @param args MsgPack array of arguments, already checked to be long enough
+ * @return T Decoded arguments
+ */
+template <typename T>
+T decodeArgs(msgpack::object const &args)
+{
+  return decodeArgs_detail(args, static_cast<T *>(nullptr),
+                           std::make_index_sequence<std::tuple_size_v<T>>{});
+}
+
+/**
+ * @brief Call a function, decoding each argument straight into the tuple it
+ * is passed from rather than default-constructing and assigning it
+ *
+ * @tparam F Callable type to bind (auto-detected by compiler)
+ * @tparam Args Decayed types of the parameters of the function
+ * @tparam I Index sequence into the arguments
+ * @param func Functor to call
+ * @param args MsgPack array of arguments, already checked to be long enough
+ * @return decltype(auto) Auto-detected return value of the functor
+ */
+template <typename F, typename... Args, std::size_t... I>
+decltype(auto) invoke_detail(F func,
+                             msgpack::object const &args,
+                             std::tuple<Args...> *,
+                             std::index_sequence<I...>)
+{
+  std::tuple<Args...> values{decoder<Args>::get(args.via.array.ptr[I])...};
+  return func(
+      pass<std::tuple_element_t<I, paramArgs<F>>>(std::get<I>(values))...);
+}
+
+/**
+ * @brief Call a function with the arguments of an RPC, without converting
+ * them into a tuple first
+ *
+ * @tparam F Callable type to bind (auto-detected by compiler)
+ * @param func Functor to call
+ * @param args MsgPack array of arguments, already checked to be long enough
+ * @return decltype(auto) Auto-detected return value of the functor
+ */
 template <typename F>
-void Server::bind(const std::string &name, F func)
+decltype(auto) invoke(F func, msgpack::object const &args)
+{
+  using args_type = typeArgs<F>;
+  return invoke_detail(
+      func, args, static_cast<args_type *>(nullptr),
+      std::make_index_sequence<std::tuple_size<args_type>::value>{});
+}
+}  // namespace support
+
+template <typename T>
+void Responder::reply(const T &value)
 {
-  if (m_rpcs.find(name) == m_rpcs.end())
+  // Pack the value straight into the reply with the codec of its type, without
+  // building an object first, collecting any blobs it holds to send as frames
+  // of their own
+  auto &sbuf = support::scratch();
+  std::vector<zmq::message_t> frames;
   {
-    insertFunc<F>(name, func, typename support::callable_traits<F>::f_rtn());
+    support::FrameSink sink(frames);
+    msgpack::packer<msgpack::sbuffer> pk(sbuf);
+    support::encode(pk, value);
+  }
+  finish(sbuf, std::move(frames), false);
+}
+
+template <typename F>
+void Server::bind(const std::string &name, F func, const BindOptions &opts)
+{
+  validate(name, opts);
+
+  if constexpr (support::task_traits<support::returnType<F>>::value)
+  {
+    insertTask<F>(name, func);
+  }
+  else if constexpr (support::future_traits<support::returnType<F>>::value)
+  {
+    insertFuture<F>(name, func);
+  }
+  else if constexpr (support::takesResponder<F>::value)
+  {
+    insertDeferred<F>(name, func);
   }
   else
   {
-    throw std::runtime_error("'" + name +
-                             "' has already been registered as an RPC.");
+    insertFunc<F>(name, func, typename support::callable_traits<F>::f_rtn());
   }
+  assign(name, opts);
+}
+
+template <typename F>
+void Server::bind_batch(const std::string &name,
+                        F func,
+                        const std::size_t maxBatch,
+                        const std::chrono::microseconds window,
+                        const BindOptions &opts)
+{
+  static_assert(support::numArgs<F>::value == 1,
+                "Batch functions take a single std::vector of arguments");
+
+  validate(name, opts);
+  insertBatch<F>(name, func, (maxBatch > 0) ? maxBatch : 1U, window);
+  assign(name, opts);
 }
 
 /**
- * @brief Insert non-void returning function into RPC map
+ * @brief Insert non-void returning function into RPC table
  *
  * @tparam F Callable type to bind (auto-detected by compiler)
  * @param name Name of the RPC
@@ -53,32 +345,19 @@ void Server::insertFunc(const std::string &name,
                             F func,
                             support::nonvoid_rtn const &)
 {
-  m_rpcs[name] = [func, name](msgpack::object const &args)
+  m_rpcs.emplace_back([func, name](msgpack::object const &args, Responder &res)
   {
-    auto called_args = args.via.array.size;
-    auto expected_args = std::tuple_size<support::typeArgs<F>>::value;
-
     // Ensure number of arguments matches
-    if (called_args != expected_args)
-    {
-      throw std::runtime_error(
-          "Function " + name + " called with " + std::to_string(called_args) +
-          " arguments; expected " + std::to_string(expected_args));
-    }
-
-    // Call the function
-    typename support::typeArgs<F> realArgs;
-    args.convert(realArgs);
-    auto zone = std::make_unique<msgpack::zone>();
-    auto rtnval = support::call(func, realArgs);
-    auto rtnobj = msgpack::object(rtnval, *zone);
+    support::checkArgs(name, args,
+                       std::tuple_size<support::typeArgs<F>>::value);
 
-    return std::make_unique<msgpack::object_handle>(rtnobj, std::move(zone));
-  };
+    // Call the function and reply with its result
+    res.reply(support::invoke(func, args));
+  });
 }
 
 /**
- * @brief Insert void returning function into RPC map
+ * @brief Insert void returning function into RPC table
  *
  * @tparam F Callable type to bind (auto-detected by compiler)
  * @param name Name of the RPC
@@ -89,26 +368,346 @@ void Server::insertFunc(const std::string &name,
                             F func,
                             support::void_rtn const &)
 {
-  m_rpcs[name] = [func, name](msgpack::object const &args)
+  m_rpcs.emplace_back([func, name](msgpack::object const &args, Responder &res)
   {
-    auto called_args = args.via.array.size;
-    auto expected_args = std::tuple_size<support::typeArgs<F>>::value;
-
     // Ensure number of arguments matches
-    if (called_args != expected_args)
+    support::checkArgs(name, args,
+                       std::tuple_size<support::typeArgs<F>>::value);
+
+    // Call the function
+    support::invoke(func, args);
+    res.reply();
+  });
+}
+
+/**
+ * @brief Insert function returning a zRPC::Task into RPC table
+ *
+ * The task is started on the calling thread and replies through the responder
+ * wherever it completes.
+ *
+ * @tparam F Callable type to bind (auto-detected by compiler)
+ * @param name Name of the RPC
+ * @param func Function to call
+ */
+template <typename F>
+void Server::insertTask(const std::string &name, F func)
+{
+  using args_type = support::typeArgs<F>;
+  using task_type = support::returnType<F>;
+  static_assert(!support::holdsViews<args_type>::value,
+                "Functions replying after they return cannot take views, which "
+                "are only valid until they return");
+
+  m_rpcs.emplace_back(
+      [func, name](msgpack::object const &args, Responder &res)
+      {
+        // Ensure number of arguments matches
+        support::checkArgs(name, args, std::tuple_size<args_type>::value);
+
+        // Keep the function and its arguments in the frame of the driving
+        // coroutine, as the task may refer to them until it completes
+        [](F f, args_type a, Responder r) -> support::Detached
+        {
+          try
+          {
+            task_type task = std::apply(f, a);
+            if constexpr (std::is_void_v<
+                              typename support::task_traits<task_type>::
+                                  value_type>)
+            {
+              co_await task;
+              r.reply();
+            }
+            else
+            {
+              r.reply(co_await task);
+            }
+          }
+          catch (const std::exception &e)
+          {
+            r.error(e.what());
+          }
+        }(func, support::decodeArgs<args_type>(args), res);
+      });
+}
+
+/**
+ * @brief Insert function returning a std::future into RPC table
+ *
+ * The future is waited on by a thread of its own, which replies as soon as it
+ * is ready.
+ *
+ * @tparam F Callable type to bind (auto-detected by compiler)
+ * @param name Name of the RPC
+ * @param func Function to call
+ */
+template <typename F>
+void Server::insertFuture(const std::string &name, F func)
+{
+  using future_type = support::returnType<F>;
+  static_assert(!support::holdsViews<support::typeArgs<F>>::value,
+                "Functions replying after they return cannot take views, which "
+                "are only valid until they return");
+
+  // RPCs are bound before the server starts, so the waiters are in place
+  // before any handler returns a future
+  if (!m_waiters)
+  {
+    m_waiters = std::make_unique<ThreadPool>(maxWaiters);
+  }
+
+  m_rpcs.emplace_back(
+      [this, func, name](msgpack::object const &args, Responder &res)
+      {
+        // Ensure number of arguments matches
+        support::checkArgs(name, args,
+                           std::tuple_size<support::typeArgs<F>>::value);
+
+        // Call the function
+        auto fut = std::make_shared<future_type>(support::invoke(func, args));
+
+        watch(
+            [fut, res]() mutable
+            {
+              try
+              {
+                if constexpr (std::is_void_v<typename support::future_traits<
+                                  future_type>::value_type>)
+                {
+                  fut->get();
+                  res.reply();
+                }
+                else
+                {
+                  res.reply(fut->get());
+                }
+              }
+              catch (const std::exception &e)
+              {
+                res.error(e.what());
+              }
+            });
+      });
+}
+
+/**
+ * @brief Insert function taking a zRPC::Responder into RPC table
+ *
+ * @tparam F Callable type to bind (auto-detected by compiler)
+ * @param name Name of the RPC
+ * @param func Function to call
+ */
+template <typename F>
+void Server::insertDeferred(const std::string &name, F func)
+{
+  using args_type = typename support::takesResponder<F>::type_args;
+  static_assert(!support::holdsViews<args_type>::value,
+                "Functions replying after they return cannot take views, which "
+                "are only valid until they return");
+
+  m_rpcs.emplace_back(
+      [func, name](msgpack::object const &args, Responder &res)
+      {
+        // Ensure number of arguments matches, not counting the responder
+        support::checkArgs(name, args, std::tuple_size<args_type>::value);
+
+        // Call the function, handing it a copy of the responder to keep
+        auto realArgs = support::decodeArgs<args_type>(args);
+        support::call([&func, &res](auto &...a) { func(res, a...); },
+                      realArgs);
+      });
+}
+
+/**
+ * @brief Insert function handling a batch of calls into RPC table
+ *
+ * Calls return at once, leaving their replies to whoever runs their batch: the
+ * call that fills the batch runs it on its own server thread, while a batch
+ * still short once the window has passed since its first call is run by a
+ * thread of its own, so that no server thread waits for others to join. Calls
+ * whose caller has given up by the time their batch runs are left out of it.
+ *
+ * @tparam F Callable type to bind (auto-detected by compiler)
+ * @param name Name of the RPC
+ * @param func Function to call
+ * @param maxBatch Maximum number of calls handed to the function at once
+ * @param window Longest time the first call of a batch waits for others
+ */
+template <typename F>
+void Server::insertBatch(const std::string &name,
+                         F func,
+                         std::size_t maxBatch,
+                         std::chrono::microseconds window)
+{
+  using batch_type = std::tuple_element_t<0, support::typeArgs<F>>;
+  using item_type = typename batch_type::value_type;
+  static_assert(!support::holdsViews<item_type>::value,
+                "Functions replying after they return cannot take views, which "
+                "are only valid until they return");
+
+  struct Batcher
+  {
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    batch_type m_items;
+    std::vector<Responder> m_responders;
+
+    /**
+     * @brief Time at which the batch being gathered is run if not yet full
+     */
+    std::chrono::steady_clock::time_point m_deadline;
+
+    /**
+     * @brief Flag telling the flushing thread to exit
+     */
+    bool m_stop{false};
+
+    /**
+     * @brief Thread running the batches whose window has passed
+     */
+    std::thread m_flusher;
+
+    ~Batcher()
     {
-      throw std::runtime_error(
-          "Function " + name + " called with " + std::to_string(called_args) +
-          " arguments; expected " + std::to_string(expected_args));
+      {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+      }
+      m_cv.notify_all();
+      if (m_flusher.joinable())
+      {
+        m_flusher.join();
+      }
     }
+  };
+  auto batcher = std::make_shared<Batcher>();
 
-    // Call the function
-    typename support::typeArgs<F> realArgs;
-    args.convert(realArgs);
-    support::call(func, realArgs);
+  // Call the function and hand each call its own result, answering the calls
+  // abandoned by their caller without running them
+  auto run = [func, name](batch_type items, std::vector<Responder> responders)
+  {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < responders.size(); ++i)
+    {
+      const auto &context = responders[i].context();
+      if (context.expired() || context.cancelled())
+      {
+        responders[i].error("Call to " + name +
+                            " was abandoned before its batch ran");
+        continue;
+      }
+      if (kept != i)
+      {
+        items[kept] = std::move(items[i]);
+        responders[kept] = std::move(responders[i]);
+      }
+      ++kept;
+    }
+    if (kept == 0)
+    {
+      return;
+    }
+    items.erase(items.begin() + static_cast<std::ptrdiff_t>(kept),
+                items.end());
+    responders.erase(
+        responders.begin() + static_cast<std::ptrdiff_t>(kept),
+        responders.end());
 
-    return std::make_unique<msgpack::object_handle>();
+    try
+    {
+      auto results = func(std::move(items));
+      if (results.size() != responders.size())
+      {
+        throw std::runtime_error(
+            "Batch function " + name + " returned " +
+            std::to_string(results.size()) + " results for " +
+            std::to_string(responders.size()) + " calls");
+      }
+      for (std::size_t i = 0; i < results.size(); ++i)
+      {
+        responders[i].reply(results[i]);
+      }
+    }
+    catch (const std::exception &e)
+    {
+      for (auto &&r : responders)
+      {
+        r.error(e.what());
+      }
+    }
   };
+
+  // The thread only refers to the batcher, which joins it when destroyed
+  batcher->m_flusher = std::thread(
+      [b = batcher.get(), run]()
+      {
+        std::unique_lock<std::mutex> lock(b->m_mtx);
+        while (!b->m_stop)
+        {
+          if (b->m_items.empty())
+          {
+            b->m_cv.wait(lock);
+          }
+          else if (std::chrono::steady_clock::now() < b->m_deadline)
+          {
+            (void)b->m_cv.wait_until(lock, b->m_deadline);
+          }
+          else
+          {
+            batch_type items;
+            std::vector<Responder> responders;
+            items.swap(b->m_items);
+            responders.swap(b->m_responders);
+            lock.unlock();
+            run(std::move(items), std::move(responders));
+            lock.lock();
+          }
+        }
+      });
+
+  m_rpcs.emplace_back(
+      [batcher, run, name, maxBatch, window](msgpack::object const &args,
+                                             Responder &res)
+      {
+        // Convert the arguments of this call into one element of the batch
+        item_type item;
+        if constexpr (support::is_tuple<item_type>::value)
+        {
+          support::checkArgs(name, args, std::tuple_size<item_type>::value);
+          item = support::decodeArgs<item_type>(args);
+        }
+        else
+        {
+          support::checkArgs(name, args, 1);
+          item = support::decoder<item_type>::get(args.via.array.ptr[0]);
+        }
+
+        batch_type items;
+        std::vector<Responder> responders;
+        {
+          std::lock_guard<std::mutex> lock(batcher->m_mtx);
+          batcher->m_items.emplace_back(std::move(item));
+          batcher->m_responders.emplace_back(res);
+
+          if (batcher->m_items.size() < maxBatch)
+          {
+            // Leave the batch to the call that fills it, or to the flushing
+            // thread once the window since its first call has passed
+            if (batcher->m_items.size() == 1)
+            {
+              batcher->m_deadline = std::chrono::steady_clock::now() + window;
+              batcher->m_cv.notify_one();
+            }
+            return;
+          }
+
+          items.swap(batcher->m_items);
+          responders.swap(batcher->m_responders);
+        }
+
+        run(std::move(items), std::move(responders));
+      });
 }
 
 }  // namespace zRPC
\ No newline at end of file
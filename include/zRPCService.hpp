@@ -0,0 +1,310 @@
+/*
+ * @file   zRPCService.hpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 10:27:53 pm
+ *
+ * @brief Typed service interfaces for the zRPC client/server library
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ZRPC_SERVICE_HPP_
+#define _ZRPC_SERVICE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Declare a method of a service interface, taking the name of the RPC
+ * and its signature
+ *
+ * A service interface is a class template deriving from its parameter, which
+ * is zRPC::Stub to call the service and zRPC::Binder to bind it:
+ * @code
+ * template <typename B>
+ * struct Calc : B
+ * {
+ *   using B::B;
+ *   ZRPC_METHOD(l1, int(int, int))
+ *   ZRPC_METHOD(l2, double(double, double))
+ * };
+ *
+ * Calc<zRPC::Binder> bind(server);
+ * bind.l2([](double a, double b) { return a * b; });
+ *
+ * Calc<zRPC::Stub> calc(client);
+ * double v = calc.l2(11, 9);
+ * @endcode
+ */
+#define ZRPC_METHOD(NAME, ...)                                   \
+  using NAME##_method = ::zRPC::Method<#NAME, __VA_ARGS__>;      \
+  template <typename... A>                                       \
+  decltype(auto) NAME(A &&...args)                               \
+  {                                                              \
+    return this->template invoke<NAME##_method>(                 \
+        std::forward<A>(args)...);                               \
+  }
+
+namespace zRPC
+{
+namespace support
+{
+/**
+ * @brief String literal usable as a template argument
+ *
+ * @tparam N Length of the literal, including its terminating null
+ */
+template <std::size_t N>
+struct FixedString
+{
+  char m_str[N];
+
+  constexpr FixedString(const char (&str)[N])
+  {
+    std::copy_n(str, N, m_str);
+  }
+};
+
+/**
+ * @brief Prepare an argument of a typed call for packing, converting it to
+ * the declared parameter type so that it is encoded with the codec of that
+ * type, as the server expects
+ *
+ * @tparam P Declared type of the parameter
+ * @tparam A Type of the argument given
+ * @param arg Argument given
+ * @return decltype(auto) Argument to pack
+ */
+template <typename P, typename A>
+decltype(auto) declared(A &&arg)
+{
+  using param_type = std::decay_t<P>;
+  static_assert(std::is_convertible_v<A &&, param_type>,
+                "Argument does not convert to the declared parameter type");
+
+  if constexpr (std::is_same_v<std::decay_t<A>, param_type>)
+  {
+    return std::forward<A>(arg);
+  }
+  else
+  {
+    return static_cast<param_type>(std::forward<A>(arg));
+  }
+}
+}  // namespace support
+
+/**
+ * @brief Method of a service interface, naming the RPC and its signature
+ *
+ * @tparam Name Name of the RPC
+ * @tparam Sig Signature of the RPC, as `R(P...)`
+ */
+template <support::FixedString Name, typename Sig>
+struct Method;
+
+template <support::FixedString Name, typename R, typename... P>
+struct Method<Name, R(P...)>
+{
+  using return_type = R;
+  using param_args = std::tuple<P...>;
+
+  /**
+   * @brief Get the name of the RPC
+   *
+   * @return const std::string& Name of the RPC
+   */
+  static const std::string &name(void)
+  {
+    static const std::string str(Name.m_str);
+    return str;
+  }
+
+  /**
+   * @brief Wrap a function in one taking exactly the declared parameters, so
+   * that the server decodes the arguments the client packed
+   *
+   * @tparam F Callable type implementing the method
+   * @param func Function implementing the method
+   * @return auto Function with the declared signature
+   */
+  template <typename F>
+  static auto wrap(F func)
+  {
+    static_assert(std::is_invocable_r_v<R, F &, P...>,
+                  "Function does not implement the declared signature");
+    return [func](P... args) mutable -> R
+    { return func(std::forward<P>(args)...); };
+  }
+};
+
+/**
+ * @class Stub zRPCService.hpp "zRPCService.hpp"
+ *
+ * @brief Client side of a service interface, calling each method as an RPC.
+ *
+ * Arguments are checked against the declared signature when the call is
+ * compiled, and the result is converted straight to the declared return type.
+ * A method answered with a zRPC::Error throws it as a std::runtime_error, as
+ * does a method not answered before the timeout.
+ */
+class Stub
+{
+private:
+  /**
+   * @brief Client to make the calls with
+   */
+  Client &m_client;
+
+  /**
+   * @brief Timeout in ms before dropping a call
+   */
+  int m_timeout;
+
+public:
+  /**
+   * @brief Construct a new zRPC::Stub object
+   *
+   * @param[in] client Client to make the calls with
+   * @param[in] timeout Timeout in ms before dropping a call, default = -1
+   */
+  explicit Stub(Client &client, const int timeout = -1) :
+      m_client(client), m_timeout(timeout)
+  {
+  }
+
+  /**
+   * @brief Call a method of the service
+   *
+   * @tparam M Method to call
+   * @tparam A Types of the arguments given
+   * @param[in] args Arguments, converting to the declared parameters
+   * @return M::return_type Result of the call
+   * @throw std::runtime_error The call was answered with a zRPC::Error, or
+   * not answered before the timeout
+   */
+  template <typename M, typename... A>
+  typename M::return_type invoke(A &&...args)
+  {
+    using params = typename M::param_args;
+    static_assert(sizeof...(A) == std::tuple_size_v<params>,
+                  "Wrong number of arguments for the declared signature");
+
+    Header hdr;
+    auto res = [&]<std::size_t... I>(std::index_sequence<I...>)
+    {
+      return m_client.request(
+          m_timeout, hdr, M::name(),
+          support::declared<std::tuple_element_t<I, params>>(
+              std::forward<A>(args))...);
+    }(std::index_sequence_for<A...>{});
+
+    // Only a call that got no reply returns a handle without a zone; a nil
+    // result alone would pass for the reply of a void method
+    if (!res.zone())
+    {
+      throw std::runtime_error("Call to '" + M::name() + "' timed out");
+    }
+
+    if (hdr.m_flags & Header::error)
+    {
+      throw std::runtime_error(res.get().template as<Error>().m_msg);
+    }
+
+    if constexpr (std::is_void_v<typename M::return_type>)
+    {
+      (void)res;
+    }
+    else
+    {
+      return decode<typename M::return_type>(res.get());
+    }
+  }
+};
+
+/**
+ * @class Binder zRPCService.hpp "zRPCService.hpp"
+ *
+ * @brief Server side of a service interface, binding a function to each
+ * method.
+ *
+ * Each function is checked against the declared signature when it is bound,
+ * and decodes the arguments as the declared parameter types.
+ */
+class Binder
+{
+private:
+  /**
+   * @brief Server to bind the methods to
+   */
+  Server &m_server;
+
+  /**
+   * @brief Options methods are bound with unless given their own
+   */
+  BindOptions m_opts;
+
+public:
+  /**
+   * @brief Construct a new zRPC::Binder object
+   *
+   * @param[in] server Server to bind the methods to
+   * @param[in] opts Options to bind the methods with
+   */
+  explicit Binder(Server &server, const BindOptions &opts = {}) :
+      m_server(server), m_opts(opts)
+  {
+  }
+
+  /**
+   * @brief Bind the function implementing a method of the service
+   *
+   * @tparam M Method to bind
+   * @tparam F Callable type implementing the method
+   * @param[in] func Function implementing the method
+   */
+  template <typename M, typename F>
+  void invoke(F func)
+  {
+    m_server.bind(M::name(), M::wrap(std::move(func)), m_opts);
+  }
+
+  /**
+   * @brief Bind the function implementing a method of the service with its
+   * own options
+   *
+   * @tparam M Method to bind
+   * @tparam F Callable type implementing the method
+   * @param[in] func Function implementing the method
+   * @param[in] opts Options to bind the method with
+   */
+  template <typename M, typename F>
+  void invoke(F func, const BindOptions &opts)
+  {
+    m_server.bind(M::name(), M::wrap(std::move(func)), opts);
+  }
+};
+}  // namespace zRPC
+
+#endif  // _ZRPC_SERVICE_HPP_
@@ -57,38 +57,41 @@ void Subscriber::handler(const std::string &uri,
 
     while (m_running)
     {
+      // Receive the topic, header and payload frames
+      zmq::message_t rtopic;
+      zmq::message_t header;
       zmq::message_t msg;
-      (void)sock.recv(msg, zmq::recv_flags::none);
+      (void)sock.recv(rtopic, zmq::recv_flags::none);
+      if (rtopic.more())
+      {
+        (void)sock.recv(header, zmq::recv_flags::none);
+      }
+      if (header.more())
+      {
+        (void)sock.recv(msg, zmq::recv_flags::none);
+      }
 
       try
       {
-        // Trim the topic from the beginning of the message for proper unpacking
-        std::string message(static_cast<char *>(msg.data()), msg.size());
-        message.erase(0, message.find_first_of(':') + 1);
-
-        // Unpack the message to the topic/data/CRC tuple
-        auto data_tuple = msgpack::unpack(message.data(), message.length());
-        std::tuple<std::string, std::string, std::uint32_t> pubdata;
-        data_tuple.get().convert(pubdata);
-
-        auto &&rtopic = std::get<0>(pubdata);
-        auto &&rdata = std::get<1>(pubdata);
-        auto &&rcrc = std::get<2>(pubdata);
-        std::uint32_t check =
-            CRC::Calculate(rdata.data(), rdata.size(), m_crcTable);
+        Header hdr;
+        if (!hdr.decode(header))
+        {
+          std::cerr << " !! Dropping message with malformed header"
+                    << std::endl;
+          continue;
+        }
 
-        if (check == rcrc)
+        std::uint32_t check = hdr.checksum(msg.data(), msg.size());
+        if (check == hdr.m_checksum)
         {
           // Unpack the data to published data type
-          T d;
-          auto data_obj =
-              msgpack::unpack(static_cast<char *>(rdata.data()), rdata.size());
-          data_obj.get().convert(d);
-          cb(rtopic, d);
+          auto data_obj = msgpack::unpack(msg.data<char>(), msg.size());
+          T d = decode<T>(data_obj.get());
+          cb(rtopic.to_string(), d);
         }
         else
         {
-          std::cerr << std::hex << "Bad checksum: CRC=" << rcrc
+          std::cerr << std::hex << "Bad checksum: " << hdr.m_checksum
                     << " != " << check << "=Check" << std::endl;
         }
       }
@@ -96,6 +99,10 @@ void Subscriber::handler(const std::string &uri,
       {
         std::cerr << " !! MessagePack Type Error: " << e.what() << std::endl;
       }
+      catch (const std::runtime_error &e)
+      {
+        std::cerr << " !! Decode Error: " << e.what() << std::endl;
+      }
     }
   }
   catch (const zmq::error_t &e)
@@ -25,10 +25,14 @@
  * SOFTWARE.
  */
 
+#include <future>
+#include <tuple>
 #include <type_traits>
 
 namespace zRPC
 {
+class Responder;
+
 namespace support
 {
 /**
@@ -89,6 +93,7 @@ struct callable_traits<R (*)(A...)>
   using return_type = R;
   using num_args = std::integral_constant<std::size_t, sizeof...(A)>;
   using type_args = std::tuple<typename std::decay<A>::type...>;
+  using param_args = std::tuple<A...>;
 
   typedef typename rtn<R>::type f_rtn;
 };
@@ -125,6 +130,62 @@ using numArgs = typename callable_traits<F>::num_args;
 template <typename F>
 using typeArgs = typename callable_traits<F>::type_args;
 
+/**
+ * @brief Helper routine to get the parameter types of F, references included
+ *
+ * @tparam F Functor type to check types of parameters
+ */
+template <typename F>
+using paramArgs = typename callable_traits<F>::param_args;
+
+/**
+ * @brief Define type to detect callables returning a std::future
+ */
+template <typename T>
+struct future_traits : std::false_type
+{
+};
+template <typename R>
+struct future_traits<std::future<R>> : std::true_type
+{
+  using value_type = R;
+};
+
+/**
+ * @brief Define type to detect std::tuple specializations
+ */
+template <typename T>
+struct is_tuple : std::false_type
+{
+};
+template <typename... A>
+struct is_tuple<std::tuple<A...>> : std::true_type
+{
+};
+
+/**
+ * @brief Define type to detect callables taking a zRPC::Responder as their
+ * first argument, and the types of their remaining arguments
+ */
+template <typename T>
+struct responder_traits : std::false_type
+{
+  using type_args = T;
+};
+template <typename... A>
+struct responder_traits<std::tuple<Responder, A...>> : std::true_type
+{
+  using type_args = std::tuple<A...>;
+};
+
+/**
+ * @brief Helper routine to check if F takes a zRPC::Responder
+ *
+ * @tparam F Functor type to check the first argument
+ */
+template <typename F>
+using takesResponder = responder_traits<typeArgs<F>>;
+
 /**
  * @brief Call the function using C++17 fold expression for the arguments
  *
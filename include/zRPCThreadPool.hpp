@@ -0,0 +1,150 @@
+/*
+ * @file   zRPCThreadPool.hpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 3:41:08 pm
+ *
+ * @brief Work-stealing thread pool for the zRPC server
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ZRPC_THREADPOOL_HPP_
+#define _ZRPC_THREADPOOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace zRPC
+{
+/**
+ * @class ThreadPool zRPCThreadPool.hpp "zRPCThreadPool.hpp"
+ *
+ * @brief Work-stealing pool of threads running queued jobs.
+ *
+ * Each thread owns a queue of jobs, taking the oldest job from its own queue
+ * first and stealing the newest job from the other queues once its own queue
+ * is empty. Jobs submitted from a pool thread are queued to that thread, while
+ * jobs submitted from any other thread are spread over the queues in turn.
+ */
+class ThreadPool
+{
+public:
+  /**
+   * @brief Job alias declaration, specifying the required prototype
+   */
+  using job_type = std::function<void()>;
+
+private:
+  // Delete copy constructor
+  ThreadPool(ThreadPool const &) = delete;
+
+  /**
+   * @brief Queue of jobs owned by one pool thread
+   */
+  struct Queue
+  {
+    std::mutex m_mtx;
+    std::deque<job_type> m_jobs;
+  };
+
+  /**
+   * @brief Per-thread job queues
+   */
+  std::vector<std::unique_ptr<Queue>> m_queues;
+
+  /**
+   * @brief Vector of thread handlers for the pool threads
+   */
+  std::vector<std::thread> m_th;
+
+  /**
+   * @brief Mutex protecting the idle threads' wait for work
+   */
+  std::mutex m_mtx;
+
+  /**
+   * @brief Condition signalled when work is queued or the pool stops
+   */
+  std::condition_variable m_cv;
+
+  /**
+   * @brief Number of jobs queued but not yet taken by a thread
+   */
+  std::atomic<std::size_t> m_queued{0};
+
+  /**
+   * @brief Index of the queue receiving the next job submitted from outside
+   * the pool
+   */
+  std::atomic<std::size_t> m_next{0};
+
+  /**
+   * @brief Flag indicating that the pool is currently running
+   */
+  bool m_running{true};
+
+  /**
+   * @brief Pool thread function
+   *
+   * @param[in] index Index of the queue owned by the thread
+   */
+  void worker(const std::size_t index);
+
+  /**
+   * @brief Take a job from the thread's own queue, or steal one from another
+   *
+   * @param[in] index Index of the queue owned by the thread
+   * @param[out] job Job taken
+   * @return true A job was taken
+   * @return false All queues were empty
+   */
+  bool take(const std::size_t index, job_type &job);
+
+public:
+  /**
+   * @brief Construct a new zRPC::ThreadPool object with the specified number
+   * of threads
+   *
+   * @param[in] nThreads Number of threads to create, default = 4
+   */
+  explicit ThreadPool(const uint32_t nThreads = 4U);
+
+  /**
+   * @brief Stop the pool once all queued jobs have run and join its threads
+   */
+  ~ThreadPool();
+
+  /**
+   * @brief Queue a job to run on the pool
+   *
+   * @param[in] job Job to run
+   */
+  void submit(job_type job);
+};
+}  // namespace zRPC
+
+#endif  // _ZRPC_THREADPOOL_HPP_
@@ -0,0 +1,161 @@
+/*
+ * @file   zRPCBlob.cpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 9:41:08 pm
+ *
+ * @brief 0MQ-based RPC client/server library with MessagePack support
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "zRPC.hpp"
+
+#include <stdexcept>
+
+using namespace zRPC;
+
+namespace
+{
+/**
+ * @brief Wrap a heap-allocated container in a 0MQ message that frees the
+ * container once 0MQ is done with it
+ */
+template <typename C>
+zmq::message_t adopt(C &&bytes)
+{
+  if (bytes.empty())
+  {
+    return zmq::message_t();
+  }
+
+  auto owner = new C(std::move(bytes));
+  return zmq::message_t(
+      owner->data(), owner->size(),
+      [](void *, void *hint) { delete static_cast<C *>(hint); }, owner);
+}
+
+/**
+ * @brief Attach the frames to the references to them in an object, counting
+ * the frames attached so far
+ */
+void attachFrames(msgpack::object &obj,
+                  std::vector<zmq::message_t> &frames,
+                  std::size_t &next)
+{
+  switch (obj.type)
+  {
+    case msgpack::type::ARRAY:
+      for (std::uint32_t i = 0; i < obj.via.array.size; ++i)
+      {
+        attachFrames(obj.via.array.ptr[i], frames, next);
+      }
+      break;
+    case msgpack::type::MAP:
+      for (std::uint32_t i = 0; i < obj.via.map.size; ++i)
+      {
+        attachFrames(obj.via.map.ptr[i].key, frames, next);
+        attachFrames(obj.via.map.ptr[i].val, frames, next);
+      }
+      break;
+    case msgpack::type::EXT:
+    {
+      if (obj.via.ext.type() != Blob::extType)
+      {
+        break;
+      }
+
+      std::size_t size = 0;
+      const auto *ref = obj.via.ext.data();
+      for (std::uint32_t i = 0; i < obj.via.ext.size; ++i)
+      {
+        size = (size << 8) | static_cast<std::uint8_t>(ref[i]);
+      }
+      if ((obj.via.ext.size != 4) || (next >= frames.size()) ||
+          (frames[next].size() != size))
+      {
+        throw std::runtime_error("Blob does not match the frames received");
+      }
+
+      auto &frame = frames[next++];
+      obj.type = msgpack::type::BIN;
+      obj.via.bin.ptr = frame.data<char>();
+      obj.via.bin.size = static_cast<std::uint32_t>(frame.size());
+      break;
+    }
+    default:
+      break;
+  }
+}
+}  // namespace
+
+Blob::Blob(std::vector<std::uint8_t> &&bytes) :
+    Blob(adopt(std::move(bytes)))
+{
+}
+
+Blob::Blob(std::string &&bytes) : Blob(adopt(std::move(bytes)))
+{
+}
+
+Blob::Blob(zmq::message_t &&msg) :
+    m_msg(std::make_shared<zmq::message_t>(std::move(msg)))
+{
+  m_data = m_msg->data<std::uint8_t>();
+  m_size = m_msg->size();
+}
+
+Blob::Blob(const void *data, std::size_t size) :
+    Blob(zmq::message_t(data, size))
+{
+}
+
+Blob Blob::view(const void *data, std::size_t size)
+{
+  Blob b;
+  b.m_data = static_cast<const std::uint8_t *>(data);
+  b.m_size = size;
+  return b;
+}
+
+zmq::message_t Blob::message(void) const
+{
+  zmq::message_t msg;
+  if (m_msg)
+  {
+    // 0MQ shares the bytes of all but the smallest messages between copies
+    msg.copy(*m_msg);
+  }
+  else
+  {
+    msg.rebuild(m_data, m_size);
+  }
+  return msg;
+}
+
+void support::attach(msgpack::object &obj,
+                     std::vector<zmq::message_t> &frames)
+{
+  std::size_t next = 0;
+  attachFrames(obj, frames, next);
+  if (next != frames.size())
+  {
+    throw std::runtime_error("Blob does not match the frames received");
+  }
+}
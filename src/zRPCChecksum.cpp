@@ -0,0 +1,277 @@
+/*
+ * @file   zRPCChecksum.cpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 2:04:17 pm
+ *
+ * @brief 0MQ-based RPC client/server library with MessagePack support
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "zRPC.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+using namespace zRPC;
+
+namespace
+{
+/**
+ * @brief Reflected CRC-32C (Castagnoli) polynomial
+ */
+constexpr std::uint32_t crc32cPoly = 0x82F63B78U;
+
+/**
+ * @brief Slicing-by-8 lookup tables, generated at compile time and shared by
+ * every connection
+ */
+using crc_table_type = std::array<std::array<std::uint32_t, 256>, 8>;
+
+constexpr crc_table_type makeTable(void)
+{
+  crc_table_type table{};
+  for (std::uint32_t i = 0; i < 256; ++i)
+  {
+    std::uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc >> 1) ^ ((crc & 1U) ? crc32cPoly : 0U);
+    }
+    table[0][i] = crc;
+  }
+  for (std::size_t k = 1; k < table.size(); ++k)
+  {
+    for (std::size_t i = 0; i < 256; ++i)
+    {
+      const auto prev = table[k - 1][i];
+      table[k][i] = (prev >> 8) ^ table[0][prev & 0xFFU];
+    }
+  }
+  return table;
+}
+
+constexpr crc_table_type crcTable = makeTable();
+
+/**
+ * @brief Load an unsigned integer from an unaligned buffer
+ */
+template <typename T>
+T load(const std::uint8_t *buf)
+{
+  T value;
+  std::memcpy(&value, buf, sizeof(T));
+  return value;
+}
+
+/**
+ * @brief Software CRC-32C using the slicing-by-8 algorithm
+ */
+std::uint32_t crc32cSoftware(const std::uint8_t *buf, std::size_t size)
+{
+  std::uint32_t crc = 0xFFFFFFFFU;
+
+  // Eight bytes at a time; the word split below assumes little-endian loads
+  if constexpr (std::endian::native == std::endian::little)
+  {
+    for (; size >= 8; size -= 8, buf += 8)
+    {
+      const auto lo = load<std::uint32_t>(buf) ^ crc;
+      const auto hi = load<std::uint32_t>(buf + 4);
+      crc = crcTable[7][lo & 0xFFU] ^ crcTable[6][(lo >> 8) & 0xFFU] ^
+            crcTable[5][(lo >> 16) & 0xFFU] ^ crcTable[4][lo >> 24] ^
+            crcTable[3][hi & 0xFFU] ^ crcTable[2][(hi >> 8) & 0xFFU] ^
+            crcTable[1][(hi >> 16) & 0xFFU] ^ crcTable[0][hi >> 24];
+    }
+  }
+
+  for (; size > 0; --size, ++buf)
+  {
+    crc = (crc >> 8) ^ crcTable[0][(crc ^ *buf) & 0xFFU];
+  }
+
+  return ~crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * @brief CRC-32C using the SSE4.2 CRC32 instruction
+ */
+__attribute__((target("sse4.2"))) std::uint32_t
+crc32cHardware(const std::uint8_t *buf, std::size_t size)
+{
+  std::uint32_t crc = 0xFFFFFFFFU;
+#if defined(__x86_64__)
+  std::uint64_t crc64 = crc;
+  for (; size >= 8; size -= 8, buf += 8)
+  {
+    crc64 = _mm_crc32_u64(crc64, load<std::uint64_t>(buf));
+  }
+  crc = static_cast<std::uint32_t>(crc64);
+#endif
+  for (; size >= 4; size -= 4, buf += 4)
+  {
+    crc = _mm_crc32_u32(crc, load<std::uint32_t>(buf));
+  }
+  for (; size > 0; --size, ++buf)
+  {
+    crc = _mm_crc32_u8(crc, *buf);
+  }
+  return ~crc;
+}
+
+/**
+ * @brief Whether the running CPU supports SSE4.2, detected on first use, as
+ * the CPU model may not be set up yet while static objects are initialized
+ */
+bool hasHardwareCrc(void)
+{
+  static const bool supported = []()
+  {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") != 0;
+  }();
+  return supported;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+/**
+ * @brief CRC-32C using the ARMv8 CRC32C instructions
+ */
+std::uint32_t crc32cHardware(const std::uint8_t *buf, std::size_t size)
+{
+  std::uint32_t crc = 0xFFFFFFFFU;
+  for (; size >= 8; size -= 8, buf += 8)
+  {
+    crc = __crc32cd(crc, load<std::uint64_t>(buf));
+  }
+  for (; size > 0; --size, ++buf)
+  {
+    crc = __crc32cb(crc, *buf);
+  }
+  return ~crc;
+}
+
+bool hasHardwareCrc(void)
+{
+  return true;
+}
+#else
+std::uint32_t crc32cHardware(const std::uint8_t *buf, std::size_t size)
+{
+  return crc32cSoftware(buf, size);
+}
+
+bool hasHardwareCrc(void)
+{
+  return false;
+}
+#endif
+
+/**
+ * @brief Load a little-endian 32-bit word regardless of host byte order
+ */
+std::uint32_t load32le(const std::uint8_t *buf)
+{
+  return static_cast<std::uint32_t>(buf[0]) |
+         (static_cast<std::uint32_t>(buf[1]) << 8) |
+         (static_cast<std::uint32_t>(buf[2]) << 16) |
+         (static_cast<std::uint32_t>(buf[3]) << 24);
+}
+
+/**
+ * @brief xxHash32 with a zero seed
+ */
+std::uint32_t xxhash32(const std::uint8_t *buf, std::size_t size)
+{
+  constexpr std::uint32_t p1 = 2654435761U;
+  constexpr std::uint32_t p2 = 2246822519U;
+  constexpr std::uint32_t p3 = 3266489917U;
+  constexpr std::uint32_t p4 = 668265263U;
+  constexpr std::uint32_t p5 = 374761393U;
+
+  const auto len = static_cast<std::uint32_t>(size);
+  std::uint32_t h;
+
+  if (size >= 16)
+  {
+    std::uint32_t v1 = p1 + p2;
+    std::uint32_t v2 = p2;
+    std::uint32_t v3 = 0;
+    std::uint32_t v4 = 0U - p1;
+    auto round = [](std::uint32_t v, std::uint32_t lane) {
+      return std::rotl(v + lane * p2, 13) * p1;
+    };
+    for (; size >= 16; size -= 16, buf += 16)
+    {
+      v1 = round(v1, load32le(buf));
+      v2 = round(v2, load32le(buf + 4));
+      v3 = round(v3, load32le(buf + 8));
+      v4 = round(v4, load32le(buf + 12));
+    }
+    h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+        std::rotl(v4, 18);
+  }
+  else
+  {
+    h = p5;
+  }
+
+  h += len;
+  for (; size >= 4; size -= 4, buf += 4)
+  {
+    h = std::rotl(h + load32le(buf) * p3, 17) * p4;
+  }
+  for (; size > 0; --size, ++buf)
+  {
+    h = std::rotl(h + *buf * p5, 11) * p1;
+  }
+
+  h ^= h >> 15;
+  h *= p2;
+  h ^= h >> 13;
+  h *= p3;
+  h ^= h >> 16;
+  return h;
+}
+}  // namespace
+
+std::uint32_t support::checksum(Integrity mode, const void *data,
+                                std::size_t size)
+{
+  auto buf = static_cast<const std::uint8_t *>(data);
+  switch (mode)
+  {
+    case Integrity::crc32c:
+      return hasHardwareCrc() ? crc32cHardware(buf, size)
+                            : crc32cSoftware(buf, size);
+    case Integrity::xxhash32:
+      return xxhash32(buf, size);
+    case Integrity::none:
+    default:
+      return 0;
+  }
+}
@@ -27,13 +27,755 @@
 
 #include "zRPC.hpp"
 
+#include <iostream>
+#include <sstream>
+
 using namespace zRPC;
 
+namespace
+{
+/**
+ * @brief Send a request header and payload, followed by the frames of any
+ * blobs the payload refers to
+ */
+void send(zmq::socket_t &sock,
+          zmq::message_t &&hdr,
+          zmq::message_t &&payload,
+          std::vector<zmq::message_t> &frames)
+{
+  (void)sock.send(hdr, zmq::send_flags::sndmore);
+  (void)sock.send(payload, frames.empty() ? zmq::send_flags::none
+                                          : zmq::send_flags::sndmore);
+  for (std::size_t i = 0; i < frames.size(); ++i)
+  {
+    (void)sock.send(frames[i], (i + 1 < frames.size())
+                                   ? zmq::send_flags::sndmore
+                                   : zmq::send_flags::none);
+  }
+}
+
+void send(zmq::socket_t &sock,
+          zmq::message_t &&hdr,
+          msgpack::sbuffer &payload,
+          std::vector<zmq::message_t> &frames)
+{
+  send(sock, std::move(hdr), support::message(payload), frames);
+}
+
+/**
+ * @brief Build a result reporting an error to the caller
+ */
+msgpack::object_handle failure(const std::string &msg)
+{
+  Error err;
+  err.m_msg = msg;
+  auto zone = std::make_unique<msgpack::zone>();
+  auto rtnobj = msgpack::object(err, *zone);
+  return msgpack::object_handle(rtnobj, std::move(zone));
+}
+
+/**
+ * @brief Receive the frames of the blobs following a reply payload
+ */
+std::vector<zmq::message_t> attachments(zmq::socket_t &sock,
+                                        const zmq::message_t &payload)
+{
+  std::vector<zmq::message_t> frames;
+  bool more = payload.more();
+  while (more)
+  {
+    frames.emplace_back();
+    (void)sock.recv(frames.back());
+    more = frames.back().more();
+  }
+  return frames;
+}
+}  // namespace
+
 Client::Client(const std::string &identity,
                const std::string &uri) :
+    Client(identity, uri, support::integrity(uri))
+{
+}
+
+Client::Client(const std::string &identity, const std::string &uri,
+               const Integrity integrity) :
     m_ctx(1),
     m_idBase(identity),
     m_uri(uri),
-    m_crcTable(CRC::CRC_32())
+    m_integrity(integrity)
+{
+}
+
+Client::~Client()
+{
+  // Wake the I/O thread with an empty message to tell it to exit
+  if (m_ioThread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_asyncMtx);
+      (void)m_asyncTx.send(zmq::message_t(), zmq::send_flags::none);
+    }
+    m_ioThread.join();
+  }
+
+  // Close all pooled connections before the context is torn down
+  std::lock_guard<std::mutex> lock(m_poolMtx);
+  m_pool.clear();
+}
+
+zmq::socket_t Client::acquire(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_poolMtx);
+    if (!m_pool.empty())
+    {
+      zmq::socket_t sock = std::move(m_pool.back());
+      m_pool.pop_back();
+      return sock;
+    }
+  }
+
+  // No idle connection available, so create a new one with a unique identity
+  zmq::socket_t sock(m_ctx, zmq::socket_type::dealer);
+  sock.set(zmq::sockopt::linger, 0);
+  sock.set(zmq::sockopt::routing_id, m_idBase + std::to_string(m_idx++));
+  sock.connect(m_uri);
+  return sock;
+}
+
+void Client::release(zmq::socket_t &&sock)
+{
+  std::lock_guard<std::mutex> lock(m_poolMtx);
+  m_pool.emplace_back(std::move(sock));
+}
+
+msgpack::object_handle Client::result(Header &hdr,
+                                      zmq::message_t &msg,
+                                      std::vector<zmq::message_t> &frames)
+{
+  if (hdr.m_flags & Header::stale)
+  {
+    // The server no longer matches the cached method ids; fall back to
+    // calling by name until it is described again
+    std::unique_lock<std::shared_mutex> lock(m_methodMtx);
+    m_methods.clear();
+    m_described = false;
+  }
+
+  std::uint32_t check = hdr.checksum(msg.data(), msg.size());
+  if (check != hdr.m_checksum)
+  {
+    std::stringstream ss;
+    ss << std::hex << "Bad checksum: " << hdr.m_checksum << " != " << check
+       << "=Checked";
+    std::cerr << ss.str() << std::endl;
+    hdr.m_flags |= Header::error;
+    return failure(ss.str());
+  }
+
+  // Hand the frames to the zone of the result, so that strings, binary data
+  // and blobs can be referenced in place for as long as the result is held
+  auto zone = std::make_unique<msgpack::zone>();
+  auto frame = std::make_unique<zmq::message_t>(std::move(msg));
+  auto blobs = std::make_unique<std::vector<zmq::message_t>>(std::move(frames));
+  const auto *data = frame->data<char>();
+  const auto size = frame->size();
+  auto &attached = *blobs;
+  zone->push_finalizer(std::move(frame));
+  zone->push_finalizer(std::move(blobs));
+  auto rtnobj = msgpack::unpack(
+      *zone, data, size,
+      [](msgpack::type::object_type, std::size_t, void *) { return true; },
+      nullptr);
+  if (!attached.empty())
+  {
+    try
+    {
+      support::attach(rtnobj, attached);
+    }
+    catch (const std::runtime_error &e)
+    {
+      Error err;
+      err.m_msg = e.what();
+      hdr.m_flags |= Header::error;
+      rtnobj = msgpack::object(err, *zone);
+    }
+  }
+  return msgpack::object_handle(rtnobj, std::move(zone));
+}
+
+msgpack::object_handle Client::exchange(const int timeout,
+                                        Header &hdr,
+                                        msgpack::sbuffer &payload,
+                                        std::vector<zmq::message_t> &frames,
+                                        const std::string &name)
+{
+  try
+  {
+    // Borrow an already connected socket for the duration of this call
+    zmq::socket_t l_sock = acquire();
+    l_sock.set(zmq::sockopt::rcvtimeo, timeout);
+
+    // Let the server know how long the reply is waited for, so that it can
+    // drop the request once nobody will read the answer
+    hdr.m_budget = (timeout > 0) ? static_cast<std::uint32_t>(timeout) : 0U;
+
+    // Send the request header and payload to the server
+    hdr.m_integrity = m_integrity;
+    hdr.m_checksum = hdr.checksum(payload.data(), payload.size());
+    send(l_sock, hdr.encode(), payload, frames);
+
+    // Wait for response or timeout event, skipping any reply that does not
+    // belong to this request
+    zmq::message_t rhdr;
+    zmq::message_t msg;
+    auto rxres = l_sock.recv(rhdr);
+    while (rxres && rhdr.more())
+    {
+      (void)l_sock.recv(msg);
+      auto blobs = attachments(l_sock, msg);
+      Header reply;
+      if (reply.decode(rhdr) && (reply.m_id == hdr.m_id))
+      {
+        // Only a socket that received its reply is safe to hand to another
+        // call
+        release(std::move(l_sock));
+        auto res = result(reply, msg, blobs);
+        hdr.m_flags = reply.m_flags;
+        return res;
+      }
+      rxres = l_sock.recv(rhdr);
+    }
+
+    std::cout << " ! ZMQ Warning server is not responding, request <" << name
+              << "> is dropped !" << std::endl;
+
+    // Tell the server to abandon the request, lingering briefly so that the
+    // cancellation is sent before the connection is closed
+    Header cancel;
+    cancel.m_id = hdr.m_id;
+    cancel.m_flags = Header::cancel;
+    cancel.m_integrity = m_integrity;
+    cancel.m_checksum = cancel.checksum(nullptr, 0);
+    l_sock.set(zmq::sockopt::linger, 100);
+    (void)l_sock.send(cancel.encode(), zmq::send_flags::sndmore);
+    (void)l_sock.send(zmq::message_t(), zmq::send_flags::none);
+  }
+  catch (const zmq::error_t &e)
+  {
+    std::cerr << " !! ZMQ Error " << e.num() << ": " << e.what() << std::endl;
+  }
+
+  return msgpack::object_handle();
+}
+
+void Client::post(Header &hdr,
+                  msgpack::sbuffer &payload,
+                  std::vector<zmq::message_t> &frames)
+{
+  try
+  {
+    // No reply will ever arrive, so the socket is immediately reusable
+    zmq::socket_t l_sock = acquire();
+    hdr.m_integrity = m_integrity;
+    hdr.m_checksum = hdr.checksum(payload.data(), payload.size());
+    send(l_sock, hdr.encode(), payload, frames);
+    release(std::move(l_sock));
+  }
+  catch (const zmq::error_t &e)
+  {
+    std::cerr << " !! ZMQ Error " << e.num() << ": " << e.what() << std::endl;
+  }
+}
+
+void Client::dispatch(Header &hdr,
+                      cb_type cb,
+                      msgpack::sbuffer &payload,
+                      std::vector<zmq::message_t> &frames,
+                      const std::string &name)
+{
+  hdr.m_integrity = m_integrity;
+  hdr.m_checksum = hdr.checksum(payload.data(), payload.size());
+
+  std::unique_lock<std::mutex> lock(m_asyncMtx);
+  try
+  {
+    if (!m_ioThread.joinable())
+    {
+      // Setup the request queue and the shared connection, then hand both
+      // ends that are not used by callers over to the I/O thread
+      const auto queue = "inproc://zrpc-client-" +
+                         std::to_string(reinterpret_cast<std::uintptr_t>(this));
+      m_asyncRx = zmq::socket_t(m_ctx, zmq::socket_type::pull);
+      m_asyncRx.bind(queue);
+      m_asyncTx = zmq::socket_t(m_ctx, zmq::socket_type::push);
+      m_asyncTx.set(zmq::sockopt::linger, 0);
+      m_asyncTx.connect(queue);
+
+      m_asyncSock = zmq::socket_t(m_ctx, zmq::socket_type::dealer);
+      m_asyncSock.set(zmq::sockopt::linger, 0);
+      m_asyncSock.set(zmq::sockopt::routing_id,
+                      m_idBase + std::to_string(m_idx++));
+      m_asyncSock.connect(m_uri);
+
+      m_ioThread = std::thread([this]() { ioLoop(); });
+    }
+
+    // Register the callback before the request can possibly be answered,
+    // keeping a share of the arguments of a request sent by method id in case
+    // the id turns out to be stale
+    auto &pending = m_pending[hdr.m_id];
+    pending.m_cb = cb;
+    if (hdr.m_method == 0)
+    {
+      send(m_asyncTx, hdr.encode(), payload, frames);
+    }
+    else
+    {
+      auto args = support::message(payload);
+      pending.m_name = name;
+      pending.m_args.copy(args);
+      pending.m_frames = support::share(frames);
+      send(m_asyncTx, hdr.encode(), std::move(args), frames);
+    }
+  }
+  catch (const zmq::error_t &e)
+  {
+    std::cerr << " !! ZMQ Error " << e.num() << ": " << e.what() << std::endl;
+
+    // Report the failure the same way a blocking call does
+    m_pending.erase(hdr.m_id);
+    lock.unlock();
+    msgpack::object_handle res;
+    cb(res);
+  }
+}
+
+bool Client::cancel(const std::uint64_t id)
+{
+  cb_type cb;
+  {
+    std::lock_guard<std::mutex> lock(m_asyncMtx);
+    auto it = m_pending.find(id);
+    if (it == m_pending.end())
+    {
+      return false;
+    }
+    cb = std::move(it->second.m_cb);
+    m_pending.erase(it);
+
+    // Tell the server through the I/O thread, so that the cancellation comes
+    // from the connection the request was sent on
+    try
+    {
+      Header hdr;
+      hdr.m_id = id;
+      hdr.m_flags = Header::cancel;
+      hdr.m_integrity = m_integrity;
+      hdr.m_checksum = hdr.checksum(nullptr, 0);
+      (void)m_asyncTx.send(hdr.encode(), zmq::send_flags::sndmore);
+      (void)m_asyncTx.send(zmq::message_t(), zmq::send_flags::none);
+    }
+    catch (const zmq::error_t &e)
+    {
+      std::cerr << " !! ZMQ Error " << e.num() << ": " << e.what() << std::endl;
+    }
+  }
+
+  msgpack::object_handle res;
+  cb(res);
+  return true;
+}
+
+void Client::ioLoop(void)
+{
+  try
+  {
+    zmq::pollitem_t items[] = {{m_asyncRx.handle(), 0, ZMQ_POLLIN, 0},
+                               {m_asyncSock.handle(), 0, ZMQ_POLLIN, 0}};
+
+    while (true)
+    {
+      (void)zmq::poll(items, 2, std::chrono::milliseconds(-1));
+
+      if (items[0].revents & ZMQ_POLLIN)
+      {
+        // Forward a queued request to the server; an empty, single-part
+        // message is the signal to exit
+        zmq::message_t hdr;
+        (void)m_asyncRx.recv(hdr);
+        if (!hdr.more())
+        {
+          break;
+        }
+
+        // Forward the payload and any blob frames following it
+        (void)m_asyncSock.send(hdr, zmq::send_flags::sndmore);
+        bool more = true;
+        while (more)
+        {
+          zmq::message_t msg;
+          (void)m_asyncRx.recv(msg);
+          more = msg.more();
+          (void)m_asyncSock.send(msg, more ? zmq::send_flags::sndmore
+                                           : zmq::send_flags::none);
+        }
+      }
+
+      if (items[1].revents & ZMQ_POLLIN)
+      {
+        zmq::message_t rhdr;
+        zmq::message_t msg;
+        (void)m_asyncSock.recv(rhdr);
+        if (!rhdr.more())
+        {
+          continue;
+        }
+        (void)m_asyncSock.recv(msg);
+        auto blobs = attachments(m_asyncSock, msg);
+
+        // Find the callback of the request this reply belongs to
+        Header reply;
+        if (!reply.decode(rhdr))
+        {
+          continue;
+        }
+
+        Pending pending;
+        {
+          std::lock_guard<std::mutex> lock(m_asyncMtx);
+          auto it = m_pending.find(reply.m_id);
+          if (it == m_pending.end())
+          {
+            continue;
+          }
+          pending = std::move(it->second);
+          m_pending.erase(it);
+        }
+
+        // A reply that cannot be unpacked still completes its call, with an
+        // error in place of the result
+        msgpack::object_handle res;
+        try
+        {
+          res = result(reply, msg, blobs);
+        }
+        catch (const std::exception &e)
+        {
+          std::cerr << " !! Bad reply: " << e.what() << std::endl;
+          res = failure(e.what());
+        }
+
+        if ((reply.m_flags & Header::stale) && !pending.m_name.empty())
+        {
+          resend(reply.m_id, std::move(pending));
+          continue;
+        }
+
+        // Nor may a throwing callback take the I/O thread down with it
+        try
+        {
+          pending.m_cb(res);
+        }
+        catch (const std::exception &e)
+        {
+          std::cerr << " !! Asynchronous callback error: " << e.what()
+                    << std::endl;
+        }
+      }
+    }
+  }
+  catch (const zmq::error_t &e)
+  {
+    std::cerr << " !! ZMQ I/O Error " << e.num() << ": " << e.what()
+              << std::endl;
+  }
+
+  // Drop any outstanding callbacks, breaking the promise of any future still
+  // waiting on a reply
+  std::lock_guard<std::mutex> lock(m_asyncMtx);
+  m_pending.clear();
+}
+
+void Client::resend(const std::uint64_t id, Pending &&pending)
+{
+  // The server changed its RPCs since it was described and did not run the
+  // call, so send it again by name; the method ids are fetched again by the
+  // next blocking call, as describing the server here would stall the thread
+  Header hdr;
+  hdr.m_id = id;
+  auto &sbuf = support::scratch();
+  msgpack::packer<msgpack::sbuffer> pk(sbuf);
+  pk.pack_array(2);
+  pk.pack(pending.m_name);
+  sbuf.write(pending.m_args.data<char>(), pending.m_args.size());
+  hdr.m_integrity = m_integrity;
+  hdr.m_checksum = hdr.checksum(sbuf.data(), sbuf.size());
+
+  auto frames = std::move(pending.m_frames);
+  {
+    std::lock_guard<std::mutex> lock(m_asyncMtx);
+    m_pending[id].m_cb = std::move(pending.m_cb);
+  }
+  send(m_asyncSock, hdr.encode(), sbuf, frames);
+}
+
+void Client::ReplyAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+  Executor *ex = Executor::current();
+  m_client.dispatch(m_hdr,
+                    [this, h, ex](msgpack::object_handle &res)
+                    {
+                      m_res = std::move(res);
+                      if (ex)
+                      {
+                        ex->post(h);
+                      }
+                      else
+                      {
+                        h.resume();
+                      }
+                    },
+                    m_payload, m_frames, m_name);
+}
+
+bool Client::describe(const int timeout)
 {
-}
\ No newline at end of file
+  Header hdr;
+  hdr.m_id = m_reqId++;
+  auto &sbuf = support::scratch();
+  msgpack::packer<msgpack::sbuffer> pk(sbuf);
+  pk.pack_array(2);
+  pk.pack(std::string("zrpc.describe"));
+  pk.pack_array(0);
+
+  std::vector<zmq::message_t> frames;
+  auto res = exchange(timeout, hdr, sbuf, frames, "zrpc.describe");
+  const auto &obj = res.get();
+  if (obj.type == msgpack::type::NIL)
+  {
+    return false;
+  }
+
+  // A server without method ids answers with an Error; keep calling it by
+  // name
+  std::unique_lock<std::shared_mutex> lock(m_methodMtx);
+  m_methods.clear();
+  if (obj.type == msgpack::type::MAP)
+  {
+    obj.convert(m_methods);
+  }
+
+  auto order = m_methods.find("zrpc.byteorder");
+  if (order != m_methods.end())
+  {
+    if (order->second != static_cast<std::uint8_t>(RawFormat::native))
+    {
+      std::cerr << " !! Server packs raw values in the other byte order; "
+                   "they will be rejected"
+                << std::endl;
+    }
+    m_methods.erase(order);
+  }
+  m_described = true;
+  return true;
+}
+
+std::uint32_t Client::method(const std::string &name)
+{
+  std::shared_lock<std::shared_mutex> lock(m_methodMtx);
+  auto it = m_methods.find(name);
+  return (it != m_methods.end()) ? it->second : 0U;
+}
+
+int Client::remaining(const int timeout,
+                      const std::chrono::steady_clock::time_point start)
+{
+  if (timeout <= 0)
+  {
+    return timeout;
+  }
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  return (elapsed < timeout) ? timeout - static_cast<int>(elapsed) : 0;
+}
+
+Client::Batch Client::batch(void)
+{
+  return Batch(*this);
+}
+
+Client::Batch::Batch(Client &client) : m_client(client)
+{
+}
+
+std::vector<msgpack::object_handle> Client::Batch::call(const int timeout)
+{
+  std::vector<msgpack::object_handle> results;
+  if (m_count == 0)
+  {
+    return results;
+  }
+
+  // Prefix the calls with the array header
+  auto &sbuf = support::scratch();
+  msgpack::packer<msgpack::sbuffer> pk(sbuf);
+  pk.pack_array(m_count);
+  sbuf.write(m_calls.data(), m_calls.size());
+
+  // Keep the frames of calls sent by method id in case the ids are stale
+  const auto start = std::chrono::steady_clock::now();
+  Header hdr;
+  hdr.m_id = m_client.m_reqId++;
+  hdr.m_flags = Header::batch;
+  auto frames = m_byId.empty() ? std::move(m_frames) : support::share(m_frames);
+  auto res = m_client.exchange(timeout, hdr, sbuf, frames, "batch");
+
+  // Split the array of results into one handle per call
+  const auto &obj = res.get();
+  if (obj.type == msgpack::type::ARRAY)
+  {
+    results.reserve(obj.via.array.size);
+    for (std::uint32_t i = 0; i < obj.via.array.size; ++i)
+    {
+      results.emplace_back(msgpack::clone(obj.via.array.ptr[i]));
+    }
+  }
+
+  const auto left = Client::remaining(timeout, start);
+  if ((hdr.m_flags & Header::stale) && !m_byId.empty() &&
+      (results.size() == m_count) && ((timeout <= 0) || (left > 0)))
+  {
+    resend(left, results);
+  }
+  return results;
+}
+
+void Client::Batch::resend(const int timeout,
+                           std::vector<msgpack::object_handle> &results)
+{
+  // All method ids come from the same description of the server, so when one
+  // is stale the server ran none of the calls sent by id; send just those
+  // calls by name, in their original order, and leave describing the server
+  // again to the next call
+
+  auto &sbuf = support::scratch();
+  msgpack::packer<msgpack::sbuffer> pk(sbuf);
+  pk.pack_array(static_cast<std::uint32_t>(m_byId.size()));
+  std::vector<zmq::message_t> frames;
+  for (auto &&c : m_byId)
+  {
+    pk.pack_array(2);
+    pk.pack(c.m_name);
+    sbuf.write(m_calls.data() + c.m_begin, c.m_end - c.m_begin);
+    for (auto i = c.m_firstFrame; i < c.m_endFrame; ++i)
+    {
+      frames.emplace_back(std::move(m_frames[i]));
+    }
+  }
+
+  Header hdr;
+  hdr.m_id = m_client.m_reqId++;
+  hdr.m_flags = Header::batch;
+  auto res = m_client.exchange(timeout, hdr, sbuf, frames, "batch");
+
+  // Leave the stale errors in place if the calls could not be sent again
+  const auto &obj = res.get();
+  if ((obj.type == msgpack::type::ARRAY) &&
+      (obj.via.array.size == m_byId.size()))
+  {
+    for (std::size_t i = 0; i < m_byId.size(); ++i)
+    {
+      results[m_byId[i].m_index] = msgpack::clone(obj.via.array.ptr[i]);
+    }
+  }
+}
+
+void Client::cache(const std::string &name, const CachePolicy &policy)
+{
+  std::lock_guard<std::mutex> lock(m_cacheMtx);
+  if (policy.m_maxEntries > 0)
+  {
+    m_caches.insert_or_assign(
+        name, support::LruCache<std::string, std::string>(policy));
+  }
+  else
+  {
+    m_caches.erase(name);
+  }
+  m_caching = !m_caches.empty();
+}
+
+void Client::invalidate(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_cacheMtx);
+  auto it = m_caches.find(name);
+  if (it != m_caches.end())
+  {
+    it->second.clear();
+  }
+  ++m_cacheEpoch;
+}
+
+void Client::invalidate(void)
+{
+  std::lock_guard<std::mutex> lock(m_cacheMtx);
+  for (auto &&[name, cache] : m_caches)
+  {
+    cache.clear();
+  }
+  ++m_cacheEpoch;
+}
+
+bool Client::lookup(const std::string &name,
+                    const msgpack::sbuffer &payload,
+                    std::string &key,
+                    std::uint64_t &epoch,
+                    msgpack::object_handle &res)
+{
+  std::lock_guard<std::mutex> lock(m_cacheMtx);
+  auto it = m_caches.find(name);
+  if (it == m_caches.end())
+  {
+    return false;
+  }
+  epoch = m_cacheEpoch;
+
+  // The payload is the packed arguments, prefixed by the name when the
+  // method id is not known, so it identifies the call within the RPC
+  key.assign(payload.data(), payload.size());
+  if (auto packed = it->second.find(key))
+  {
+    res = msgpack::unpack(packed->data(), packed->size());
+    return true;
+  }
+  return false;
+}
+
+void Client::store(const std::string &name,
+                   std::string &&key,
+                   std::uint64_t epoch,
+                   const msgpack::object_handle &res)
+{
+  // Nothing is returned when the server does not respond, which must not be
+  // mistaken for a result
+  if (res.get().type == msgpack::type::NIL)
+  {
+    return;
+  }
+
+  auto &sbuf = support::scratch();
+  msgpack::pack(sbuf, res.get());
+
+  // Drop results that may predate an invalidation
+  std::lock_guard<std::mutex> lock(m_cacheMtx);
+  auto it = m_caches.find(name);
+  if ((it != m_caches.end()) && (epoch == m_cacheEpoch))
+  {
+    const auto bytes = key.size() + sbuf.size();
+    it->second.insert(std::move(key), std::string(sbuf.data(), sbuf.size()),
+                      bytes);
+  }
+}
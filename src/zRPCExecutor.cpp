@@ -0,0 +1,120 @@
+/*
+ * @file   zRPCExecutor.cpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 9:41:02 am
+ *
+ * @brief C++20 coroutine support for the zRPC client/server library
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "zRPC.hpp"
+
+#include <iostream>
+
+using namespace zRPC;
+
+namespace
+{
+/**
+ * @brief Executor owning the calling thread, if any
+ */
+thread_local Executor *t_current = nullptr;
+}  // namespace
+
+Executor::Executor(const uint32_t nThreads)
+{
+  for (uint32_t n = 0; n < nThreads; ++n)
+  {
+    m_th.emplace_back(std::thread([this]() { worker(); }));
+  }
+}
+
+Executor::~Executor()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_running = false;
+  }
+  m_cv.notify_all();
+
+  // Loop over all executor threads and join them
+  for (auto &t : m_th)
+  {
+    if (t.joinable())
+    {
+      t.join();
+    }
+  }
+}
+
+void Executor::post(std::coroutine_handle<> h)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_queue.push_back(h);
+  }
+  m_cv.notify_one();
+}
+
+void Executor::spawn(Task<void> task)
+{
+  [](Executor &ex, Task<void> t) -> support::Detached
+  {
+    co_await ex.schedule();
+    try
+    {
+      co_await t;
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << " !! Executor Task Error: " << e.what() << std::endl;
+    }
+  }(*this, std::move(task));
+}
+
+Executor *Executor::current(void)
+{
+  return t_current;
+}
+
+void Executor::worker(void)
+{
+  t_current = this;
+
+  while (true)
+  {
+    std::coroutine_handle<> h;
+    {
+      std::unique_lock<std::mutex> lock(m_mtx);
+      m_cv.wait(lock, [this]() { return !m_running || !m_queue.empty(); });
+      if (m_queue.empty())
+      {
+        // Only exit once all queued coroutines have been resumed
+        break;
+      }
+      h = m_queue.front();
+      m_queue.pop_front();
+    }
+    h.resume();
+  }
+
+  t_current = nullptr;
+}
@@ -0,0 +1,119 @@
+/*
+ * @file   zRPCHeader.cpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 1:20:31 pm
+ *
+ * @brief 0MQ-based RPC client/server library with MessagePack support
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "zRPC.hpp"
+
+using namespace zRPC;
+
+namespace
+{
+/**
+ * @brief Write an unsigned integer to a buffer in little-endian byte order
+ */
+template <typename T>
+void put(std::uint8_t *buf, T value)
+{
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    buf[i] = static_cast<std::uint8_t>(value >> (8U * i));
+  }
+}
+
+/**
+ * @brief Read an unsigned integer from a buffer in little-endian byte order
+ */
+template <typename T>
+T get(const std::uint8_t *buf)
+{
+  T value = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    value = static_cast<T>(value | (static_cast<T>(buf[i]) << (8U * i)));
+  }
+  return value;
+}
+}  // namespace
+
+zmq::message_t Header::encode(void) const
+{
+  zmq::message_t msg(size);
+  auto buf = msg.data<std::uint8_t>();
+  put<std::uint8_t>(buf + 0, version);
+  put<std::uint8_t>(buf + 1, static_cast<std::uint8_t>(m_integrity));
+  put<std::uint16_t>(buf + 2, m_flags);
+  put<std::uint32_t>(buf + 4, m_checksum);
+  put<std::uint64_t>(buf + 8, m_id);
+  put<std::uint32_t>(buf + 16, m_method);
+  put<std::uint32_t>(buf + 20, m_budget);
+  return msg;
+}
+
+bool Header::decode(const zmq::message_t &msg)
+{
+  if (msg.size() != size)
+  {
+    return false;
+  }
+
+  auto buf = msg.data<std::uint8_t>();
+  if (get<std::uint8_t>(buf + 0) != version)
+  {
+    return false;
+  }
+  const auto integrity = get<std::uint8_t>(buf + 1);
+  if (integrity > static_cast<std::uint8_t>(Integrity::xxhash32))
+  {
+    return false;
+  }
+  m_integrity = static_cast<Integrity>(integrity);
+  m_flags = get<std::uint16_t>(buf + 2);
+  m_checksum = get<std::uint32_t>(buf + 4);
+  m_id = get<std::uint64_t>(buf + 8);
+  m_method = get<std::uint32_t>(buf + 16);
+  m_budget = get<std::uint32_t>(buf + 20);
+  return true;
+}
+
+std::uint32_t Header::checksum(const void *data, std::size_t size) const
+{
+  return seal(support::checksum(m_integrity, data, size));
+}
+
+std::uint32_t Header::seal(std::uint32_t sum) const
+{
+  if (m_integrity == Integrity::none)
+  {
+    return 0;
+  }
+
+  // Check the header as encoded, with the payload checksum standing in for
+  // its own
+  Header sealed = *this;
+  sealed.m_checksum = sum;
+  const auto msg = sealed.encode();
+  return support::checksum(m_integrity, msg.data(), msg.size());
+}
@@ -35,9 +35,14 @@ Publisher::Publisher(const uint16_t port) :
 }
 
 Publisher::Publisher(const std::string &uri) :
+    Publisher(uri, support::integrity(uri))
+{
+}
+
+Publisher::Publisher(const std::string &uri, const Integrity integrity) :
     m_ctx(1),
     m_pub(m_ctx, zmq::socket_type::pub),
-    m_crcTable(CRC::CRC_32())
+    m_integrity(integrity)
 {
   try
   {
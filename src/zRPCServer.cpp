@@ -27,28 +27,182 @@
 
 #include "zRPC.hpp"
 
+#include <algorithm>
 #include <csignal>
+#include <deque>
 #include <iostream>
+#include <utility>
 
 using namespace zRPC;
 
-Server::Server(const uint16_t port, const uint32_t nWorkers) :
-    Server("tcp://*:" + std::to_string(port), nWorkers)
+namespace
+{
+/**
+ * @brief Receive all frames of a multipart message
+ */
+std::vector<zmq::message_t> receive(zmq::socket_t &sock)
+{
+  std::vector<zmq::message_t> frames;
+  do
+  {
+    frames.emplace_back();
+    (void)sock.recv(frames.back());
+  } while (frames.back().more());
+  return frames;
+}
+
+/**
+ * @brief Read a big-endian length field of a MessagePack header
+ */
+std::size_t length(const std::uint8_t *buf, std::size_t bytes)
+{
+  std::size_t len = 0;
+  for (std::size_t i = 0; i < bytes; ++i)
+  {
+    len = (len << 8) | buf[i];
+  }
+  return len;
+}
+
+/**
+ * @brief Find the RPC name at the start of a (name, arguments) payload
+ * without unpacking it
+ *
+ * @return std::string_view Name of the RPC, or empty if the payload does not
+ * start with one
+ */
+std::string_view peekName(const zmq::message_t &msg)
+{
+  auto buf = msg.data<std::uint8_t>();
+  const auto size = msg.size();
+
+  // Skip the array header
+  std::size_t pos = 0;
+  if ((size > 0) && ((buf[0] & 0xF0U) == 0x90U))
+  {
+    pos = 1;
+  }
+  else if ((size > 2) && (buf[0] == 0xDCU))
+  {
+    pos = 3;
+  }
+  else if ((size > 4) && (buf[0] == 0xDDU))
+  {
+    pos = 5;
+  }
+  else
+  {
+    return {};
+  }
+
+  // Read the string header
+  if (pos >= size)
+  {
+    return {};
+  }
+  std::size_t len = 0;
+  const auto marker = buf[pos];
+  if ((marker & 0xE0U) == 0xA0U)
+  {
+    len = marker & 0x1FU;
+    pos += 1;
+  }
+  else if ((marker >= 0xD9U) && (marker <= 0xDBU))
+  {
+    const std::size_t bytes = 1U << (marker - 0xD9U);
+    if (pos + 1 + bytes > size)
+    {
+      return {};
+    }
+    len = length(buf + pos + 1, bytes);
+    pos += 1 + bytes;
+  }
+  else
+  {
+    return {};
+  }
+
+  if (pos + len > size)
+  {
+    return {};
+  }
+  return std::string_view(reinterpret_cast<const char *>(buf + pos), len);
+}
+
+/**
+ * @brief Build the key of a request in the table of active requests from the
+ * identity of the client and the request identifier
+ */
+std::string activeKey(const zmq::message_t &identity, std::uint64_t id)
+{
+  std::string key(identity.data<char>(), identity.size());
+  key.append(reinterpret_cast<const char *>(&id), sizeof(id));
+  return key;
+}
+
+/**
+ * @brief Context of the request executing on this thread, if any
+ */
+thread_local const Context *currentContext = nullptr;
+
+/**
+ * @brief Make a context current on the calling thread for the lifetime of the
+ * scope
+ */
+class ContextScope
+{
+public:
+  explicit ContextScope(const Context &context) :
+      m_previous(std::exchange(currentContext, &context))
+  {
+  }
+
+  ~ContextScope()
+  {
+    currentContext = m_previous;
+  }
+
+private:
+  // Delete copy constructor
+  ContextScope(ContextScope const &) = delete;
+
+  const Context *m_previous;
+};
+
+}  // namespace
+
+Server::Server(const uint16_t port,
+               const uint32_t nWorkers,
+               const std::size_t maxPending) :
+    Server("tcp://*:" + std::to_string(port), nWorkers, maxPending)
 {
 }
 
 Server::Server(const std::string &uri,
-               const uint32_t nWorkers) :
+               const uint32_t nWorkers,
+               const std::size_t maxPending) :
     m_ctx(16),
-    m_brokerFrontend(m_ctx, zmq::socket_type::router),
-    m_brokerBackend(m_ctx, zmq::socket_type::dealer),
-    m_crcTable(CRC::CRC_32())
+    m_frontend(m_ctx, zmq::socket_type::router),
+    m_wakeTx(m_ctx, zmq::socket_type::push),
+    m_wakeRx(m_ctx, zmq::socket_type::pull),
+    m_maxPending(maxPending)
 {
+  // Like any other pool, the default pool runs no more requests at once than
+  // it has threads, so the rest wait in its backlog in order of priority
+  m_pools.emplace_back();
+  m_pools.back().m_threads = std::make_unique<ThreadPool>(nWorkers);
+  m_pools.back().m_limit = nWorkers;
+
   try
   {
-    // Start the broker sockets and bind to their ports
-    m_brokerFrontend.bind(uri);
-    m_brokerBackend.bind("inproc://backend");
+    // Start the front-end socket and bind to its port, then connect the
+    // wake-up sockets used to hand replies back to the I/O thread
+    m_frontend.bind(uri);
+    const auto wake = "inproc://zrpc-server-" +
+                      std::to_string(reinterpret_cast<std::uintptr_t>(this));
+    m_wakeRx.bind(wake);
+    m_wakeTx.set(zmq::sockopt::linger, 0);
+    m_wakeTx.connect(wake);
   }
   catch (const zmq::error_t &e)
   {
@@ -56,38 +210,234 @@ Server::Server(const std::string &uri,
   }
 
   m_running = true;
-  for (uint32_t n = 0; n < nWorkers; ++n)
-  {
-    // Create and connect the worker sockets now
-    m_th.emplace_back(std::thread([this]() { worker(); }));
-  }
 }
 
 Server::~Server()
 {
-  // Ensure we have shut things down completely
+  // Ensure we have shut things down completely; the thread pools finish any
+  // queued requests as they are destroyed
   stop();
 
-  // Loop over all worker threads and join them
-  for (auto &t : m_th)
-  {
-    if (t.joinable())
-    {
-      t.join();
-    }
-  }
+  // Let the pools, batches and deferred results still pending reply while
+  // everything they reply through is alive
+  m_pools.clear();
+  m_rpcs.clear();
+  m_waiters.reset();
 }
 
 void Server::start(void)
 {
-  // Start the proxy to connect multiple clients to multiple workers
+  // Number of requests received and not yet completed
+  std::size_t inflight = 0;
+
+  // Run the I/O loop, receiving requests for the worker pools and sending the
+  // replies they hand back
   try
   {
-    zmq::proxy(m_brokerFrontend, m_brokerBackend);
+    zmq::pollitem_t items[] = {{m_wakeRx.handle(), 0, ZMQ_POLLIN, 0},
+                               {m_frontend.handle(), 0, ZMQ_POLLIN, 0}};
+
+    while (m_running)
+    {
+      (void)zmq::poll(items, 2, std::chrono::milliseconds(-1));
+
+      if (items[0].revents & ZMQ_POLLIN)
+      {
+        // Drain the wake-up signals, then send every reply queued so far
+        zmq::message_t wake;
+        while (m_wakeRx.recv(wake, zmq::recv_flags::dontwait))
+        {
+        }
+
+        std::deque<Completion> done;
+        {
+          std::lock_guard<std::mutex> lock(m_completionMtx);
+          done.swap(m_completions);
+        }
+
+        bool terminate = false;
+        for (auto &&c : done)
+        {
+          if (c.m_release)
+          {
+            --m_pools[c.m_pool].m_inflight;
+          }
+          if (!c.m_complete)
+          {
+            continue;
+          }
+
+          --inflight;
+          m_active.erase(c.m_key);
+          auto &cl = (c.m_method != 0) ? m_lanes[c.m_method - 1U]
+                                       : m_defaultLane;
+          --cl.m_inflight;
+          if (c.m_reply && !c.m_argsKey.empty())
+          {
+            auto &l = m_lanes[c.m_method - 1U];
+            Header rhdr;
+            (void)rhdr.decode(c.m_header);
+            CachedReply packed{
+                std::string(c.m_payload.data<char>(), c.m_payload.size()),
+                rhdr.m_integrity, c.m_sum, rhdr.m_flags};
+
+            // Answer everyone who made the same call while it was running
+            auto flight = l.m_flights.find(c.m_argsKey);
+            if (flight != l.m_flights.end())
+            {
+              for (auto &&[identity, whdr] : flight->second)
+              {
+                replay(identity, whdr, packed, support::share(c.m_frames));
+              }
+              l.m_flights.erase(flight);
+            }
+
+            // Keep the packed reply of a pure RPC to answer later calls with
+            // the same arguments, unless it refers to blobs
+            if (l.m_cache && !c.m_failed && c.m_frames.empty())
+            {
+              const auto bytes = c.m_argsKey.size() + c.m_payload.size();
+              l.m_cache->insert(std::move(c.m_argsKey), std::move(packed),
+                                bytes);
+            }
+          }
+          if (c.m_reply)
+          {
+            (void)m_frontend.send(c.m_identity, zmq::send_flags::sndmore);
+            (void)m_frontend.send(c.m_header, zmq::send_flags::sndmore);
+            (void)m_frontend.send(c.m_payload, c.m_frames.empty()
+                                                   ? zmq::send_flags::none
+                                                   : zmq::send_flags::sndmore);
+            for (std::size_t i = 0; i < c.m_frames.size(); ++i)
+            {
+              (void)m_frontend.send(c.m_frames[i],
+                                    (i + 1 < c.m_frames.size())
+                                        ? zmq::send_flags::sndmore
+                                        : zmq::send_flags::none);
+            }
+          }
+          terminate = terminate || c.m_terminate;
+        }
+
+        // Start any requests that were waiting for the completed ones
+        for (auto &&pool : m_pools)
+        {
+          schedule(pool);
+        }
+
+        if (terminate)
+        {
+          stop();
+        }
+      }
+
+      if (items[1].revents & ZMQ_POLLIN)
+      {
+        // Receive the client identity, request header and payload frames,
+        // followed by those of any blobs, and queue the request to the pool
+        // of its RPC
+        auto frames = receive(m_frontend);
+        Header hdr;
+        if ((frames.size() < 3) || !hdr.decode(frames[1]))
+        {
+          std::cerr << " !! Dropping request with malformed header"
+                    << std::endl;
+          continue;
+        }
+
+        if (hdr.m_flags & Header::cancel)
+        {
+          // Signal the request being cancelled, if it has not completed yet
+          auto it = m_active.find(activeKey(frames[0], hdr.m_id));
+          if (it != m_active.end())
+          {
+            it->second.cancel();
+          }
+          continue;
+        }
+
+        auto method = lane(hdr, frames[2]);
+        auto &l = (method != 0) ? m_lanes[method - 1U] : m_defaultLane;
+        auto &pool = m_pools[l.m_pool];
+
+        // Answer calls to pure RPCs with arguments seen before straight from
+        // the cache, and have calls identical to one already in progress wait
+        // for its reply, without queueing either of them at all. Calls passing
+        // blobs are not identified by their payload alone, so always run.
+        std::string argsKey;
+        if ((l.m_cache || l.m_coalesce) && !(hdr.m_flags & Header::oneway) &&
+            (frames.size() == 3))
+        {
+          argsKey.assign(frames[2].data<char>(), frames[2].size());
+          auto cached = l.m_cache ? l.m_cache->find(argsKey) : nullptr;
+          if (cached)
+          {
+            replay(frames[0], hdr, *cached);
+            continue;
+          }
+
+          auto flight = l.m_flights.find(argsKey);
+          if (flight != l.m_flights.end())
+          {
+            flight->second.emplace_back(std::move(frames[0]), hdr);
+            continue;
+          }
+        }
+
+        // Reject the request straight away when the server, the RPC or its
+        // pool is over its limits, rather than leave the client waiting
+        if ((inflight >= m_maxPending) ||
+            ((l.m_limit > 0) && (l.m_inflight >= l.m_limit)) ||
+            ((pool.m_maxQueued > 0) && (pool.m_queued >= pool.m_maxQueued) &&
+             (pool.m_inflight >= pool.m_limit)))
+        {
+          Error err;
+          err.m_msg = "Server overloaded";
+          err.m_code = Error::overloaded;
+          reject(frames[0], hdr, err);
+          continue;
+        }
+
+        auto req = std::make_shared<Request>();
+        req->m_key = activeKey(frames[0], hdr.m_id);
+        req->m_identity = std::move(frames[0]);
+        req->m_payload = std::move(frames[2]);
+        req->m_frames.reserve(frames.size() - 3);
+        for (std::size_t i = 3; i < frames.size(); ++i)
+        {
+          req->m_frames.emplace_back(std::move(frames[i]));
+        }
+        req->m_pool = l.m_pool;
+        req->m_method = method;
+        if (l.m_coalesce && !argsKey.empty())
+        {
+          // Others may come to depend on this call, so it always runs to
+          // completion
+          l.m_flights[argsKey];
+        }
+        else
+        {
+          if (hdr.m_budget > 0)
+          {
+            req->m_context = Context(Context::clock_type::now() +
+                                     std::chrono::milliseconds(hdr.m_budget));
+          }
+          m_active[req->m_key] = req->m_context.token();
+        }
+        req->m_argsKey = std::move(argsKey);
+
+        ++inflight;
+        ++l.m_inflight;
+        ++pool.m_queued;
+        pool.m_backlog[static_cast<std::size_t>(l.m_priority)].emplace_back(
+            req, hdr);
+        schedule(pool);
+      }
+    }
   }
   catch (const zmq::error_t &e)
   {
-    std::cerr << " !! ZMQ Proxy Error " << e.num() << ": " << e.what()
+    std::cerr << " !! ZMQ I/O Error " << e.num() << ": " << e.what()
               << std::endl;
   }
 }
@@ -105,105 +455,608 @@ void Server::stop(void)
   m_ctx.shutdown();
 }
 
-void Server::worker(void)
+void Server::process(request_type req, Header hdr)
 {
+  auto &msg = req->m_payload;
+
+  // The caller has already given up on the reply, so complete the request as
+  // if it were one-way rather than spend time executing it
+  if (req->m_context.expired() || req->m_context.cancelled())
+  {
+    hdr.m_flags |= Header::oneway;
+    reply(*req, hdr, support::scratch());
+    return;
+  }
+
   try
   {
-    zmq::socket_t sock(m_ctx, zmq::socket_type::dealer);
-    sock.connect("inproc://backend");
+    std::uint32_t check = hdr.checksum(msg.data(), msg.size());
+    if (check != hdr.m_checksum)
+    {
+      std::stringstream ss;
+      ss << std::hex << "Bad checksum: " << hdr.m_checksum << " != " << check
+         << "=Checked";
+      std::cout << ss.str() << std::endl;
+      Responder(respond(req, hdr)).error(ss.str());
+      return;
+    }
 
-    while (m_running)
+    // Unpack the payload once, referencing strings and binary data in the
+    // received message rather than copying them. Each thread keeps its zone
+    // from one request to the next, so once it has grown to fit the payloads
+    // it sees, unpacking only resets it instead of allocating a new one.
+    auto &zone = support::arena();
+    zone.clear();
+    auto data = msgpack::unpack(
+        zone, msg.data<char>(), msg.size(),
+        [](msgpack::type::object_type, std::size_t, void *) { return true; },
+        nullptr);
+    if (!req->m_frames.empty())
     {
-      zmq::message_t identity;
-      zmq::message_t msg;
-      (void)sock.recv(identity);
-      (void)sock.recv(msg);
-
-      // Unpack and convert the message and CRC
-      auto crcdata =
-          msgpack::unpack(static_cast<char *>(msg.data()), msg.size());
-      std::tuple<std::string, std::uint32_t> crcrpc;
-      crcdata.get().convert(crcrpc);
-
-      auto &&rpcmsg = std::get<0>(crcrpc);
-      auto &&crc = std::get<1>(crcrpc);
-      std::uint32_t check =
-          CRC::Calculate(rpcmsg.data(), rpcmsg.size(), m_crcTable);
-
-      std::unique_ptr<msgpack::v1::object_handle> res;
-      if (check == crc)
-      {
-        // Unpack and convert RPC name and arguments
-        std::tuple<std::string, msgpack::object> rpc;
-        auto data =
-            msgpack::unpack(static_cast<char *>(rpcmsg.data()), rpcmsg.size());
-        data.get().convert(rpc);
+      support::attach(data, req->m_frames);
+    }
 
-        // Call the RPC
-        auto &&name = std::get<0>(rpc);
-        auto &&args = std::get<1>(rpc);
+    if (hdr.m_flags & Header::batch)
+    {
+      // Unpack all RPC names or method ids and arguments
+      std::vector<std::tuple<msgpack::object, msgpack::object>> calls;
+      data.convert(calls);
 
-        if ("terminate" == name)
-        {
-          // Respond with an empty message
-          res = std::make_unique<msgpack::object_handle>();
-          reply(sock, identity, res);
+      // Gather the results of the calls, which may complete in any order, and
+      // reply with the array of results once the last one completes
+      struct Gather
+      {
+        Header m_hdr;
+        std::vector<std::string> m_results;
+        std::vector<std::vector<zmq::message_t>> m_frames;
+        std::atomic<std::size_t> m_remaining;
+      };
+      auto gather = std::make_shared<Gather>();
+      gather->m_hdr = hdr;
+      gather->m_results.resize(calls.size());
+      gather->m_frames.resize(calls.size());
+      gather->m_remaining = calls.size() + 1;
 
-          // Now stop the server
-          stop();
-        }
-        else
+      // The results are already packed, so the reply is the array header
+      // followed by each result in turn, and the frames of their blobs in the
+      // same order
+      auto collect = [this, req, gather]()
+      {
+        auto &sbuf = support::scratch();
+        msgpack::packer<msgpack::sbuffer> pk(sbuf);
+        pk.pack_array(static_cast<std::uint32_t>(gather->m_results.size()));
+        std::vector<zmq::message_t> frames;
+        for (std::size_t i = 0; i < gather->m_results.size(); ++i)
         {
-          if (m_rpcs.find(name) != m_rpcs.end())
+          auto &&r = gather->m_results[i];
+          sbuf.write(r.data(), r.size());
+          for (auto &&f : gather->m_frames[i])
           {
-            res = m_rpcs.at(name)(args);
+            frames.emplace_back(std::move(f));
           }
-          else
+        }
+        respond(req, gather->m_hdr)(sbuf, std::move(frames), false);
+      };
+
+      // Call each RPC in order
+      for (std::size_t i = 0; i < calls.size(); ++i)
+      {
+        Responder res(
+            [gather, collect, i](msgpack::sbuffer &packed,
+                                 std::vector<zmq::message_t> frames, bool)
+            {
+              gather->m_results[i].assign(packed.data(), packed.size());
+              gather->m_frames[i] = std::move(frames);
+              if (--gather->m_remaining == 0)
+              {
+                collect();
+              }
+            },
+            req->m_context);
+
+        auto &&target = std::get<0>(calls[i]);
+        if (target.type == msgpack::type::POSITIVE_INTEGER)
+        {
+          auto method = target.as<std::uint32_t>();
+          if (!current(method))
           {
-            Error err;
-            err.m_msg = "'" + name + "' RPC not found!";
-            auto zone = std::make_unique<msgpack::zone>();
-            auto rtnobj = msgpack::object(err, *zone);
-            res = std::make_unique<msgpack::object_handle>(rtnobj,
-                                                           std::move(zone));
+            gather->m_hdr.m_flags |= Header::stale;
           }
-          reply(sock, identity, res);
+          execute(method, std::get<1>(calls[i]), res);
+        }
+        else
+        {
+          execute(target.as<std::string>(), std::get<1>(calls[i]), res);
         }
       }
+
+      // Release the hold on the reply taken while calls were being started
+      if (--gather->m_remaining == 0)
+      {
+        collect();
+      }
+    }
+    else if (hdr.m_method != 0)
+    {
+      // The payload is just the arguments of the RPC named by the header
+      if (!current(hdr.m_method))
+      {
+        hdr.m_flags |= Header::stale;
+      }
+      Responder res(respond(req, hdr), req->m_context);
+      execute(hdr.m_method, data, res);
+    }
+    else
+    {
+      // Unpack and convert RPC name and arguments
+      std::tuple<std::string, msgpack::object> rpc;
+      data.convert(rpc);
+
+      // Call the RPC
+      auto &&name = std::get<0>(rpc);
+      auto &&args = std::get<1>(rpc);
+
+      if ("terminate" == name)
+      {
+        // Respond with an empty message, then stop the server
+        auto &sbuf = support::scratch();
+        msgpack::packer<msgpack::sbuffer>(sbuf).pack_nil();
+        reply(*req, hdr, sbuf, {}, true);
+      }
+      else if ("zrpc.describe" == name)
+      {
+        Responder(respond(req, hdr)).reply(describe());
+      }
       else
       {
-        Error err;
-        std::stringstream ss;
-        ss << std::hex << "Bad checksum: CRC=" << crc << " != " << check
-           << "=Checked";
-        std::cout << ss.str() << std::endl;
-        err.m_msg = ss.str();
-        auto zone = std::make_unique<msgpack::zone>();
-        auto rtnobj = msgpack::object(err, *zone);
-        res = std::make_unique<msgpack::object_handle>(rtnobj, std::move(zone));
-        reply(sock, identity, res);
+        Responder res(respond(req, hdr), req->m_context);
+        execute(name, args, res);
       }
     }
   }
+  catch (const std::exception &e)
+  {
+    // Answer payloads that do not unpack as a call with an error instead of
+    // leaving the client waiting
+    Responder(respond(req, hdr)).error(e.what());
+  }
+}
+
+Responder::done_type Server::respond(request_type req, const Header &hdr)
+{
+  return [this, req, hdr](msgpack::sbuffer &packed,
+                          std::vector<zmq::message_t> frames, bool failed)
+  {
+    req->m_failed = failed;
+    reply(*req, hdr, packed, std::move(frames));
+  };
+}
+
+void Server::complete(Completion &&done)
+{
+  try
+  {
+    std::lock_guard<std::mutex> lock(m_completionMtx);
+    m_completions.emplace_back(std::move(done));
+
+    // The I/O thread drains the queue on each wake-up, so only the first
+    // entry queued since then needs to wake it
+    if (m_completions.size() == 1)
+    {
+      (void)m_wakeTx.send(zmq::message_t(), zmq::send_flags::dontwait);
+    }
+  }
   catch (const zmq::error_t &e)
   {
-    std::cerr << " !! ZMQ Worker Error " << e.num() << ": " << e.what()
-              << std::endl;
+    std::cerr << " !! ZMQ Error " << e.num() << ": " << e.what() << std::endl;
+  }
+}
+
+void Server::watch(std::function<void()> wait)
+{
+  m_waiters->submit(std::move(wait));
+}
+
+void Server::execute(const std::string &name,
+                     const msgpack::object &args,
+                     Responder &res)
+{
+  auto it = m_methods.find(name);
+  if (it != m_methods.end())
+  {
+    execute((fingerprint() << 16) | it->second, args, res);
+  }
+  else
+  {
+    res.error("'" + name + "' RPC not found!");
+  }
+}
+
+void Server::execute(std::uint32_t method,
+                     const msgpack::object &args,
+                     Responder &res)
+{
+  if (!current(method))
+  {
+    res.error("Method id " + std::to_string(method) +
+              " is not bound; describe the server again");
+    return;
+  }
+
+  try
+  {
+    ContextScope scope(res.context());
+    m_rpcs[(method & 0xFFFFU) - 1U](args, res);
+  }
+  catch (const std::exception &e)
+  {
+    // Report argument mismatches and handler failures to the client
+    res.error(e.what());
+  }
+}
+
+void Server::reply(Request &req,
+                   const Header &hdr,
+                   msgpack::sbuffer &packed,
+                   std::vector<zmq::message_t> frames,
+                   const bool terminate)
+{
+  // One-way and cancelled requests have nobody waiting for the result, so
+  // only tell the I/O thread that the request is complete
+  if ((hdr.m_flags & Header::oneway) || req.m_context.cancelled())
+  {
+    Completion done;
+    done.m_terminate = terminate;
+    done.m_release = !req.m_released.exchange(true);
+    done.m_pool = req.m_pool;
+    done.m_method = req.m_method;
+    done.m_key = std::move(req.m_key);
+    complete(std::move(done));
+    return;
+  }
+
+  // Echo the request identifier so the client can match the reply, and check
+  // the reply the same way the client checked its request
+  Header rhdr;
+  rhdr.m_id = hdr.m_id;
+  rhdr.m_flags = hdr.m_flags & Header::stale;
+  if (req.m_failed)
+  {
+    rhdr.m_flags |= Header::error;
+  }
+  rhdr.m_integrity = hdr.m_integrity;
+  const auto sum =
+      support::checksum(rhdr.m_integrity, packed.data(), packed.size());
+  rhdr.m_checksum = rhdr.seal(sum);
+
+  // Hand the reply, addressed with the identity of the client, to the I/O
+  // thread
+  Completion done;
+  done.m_identity = std::move(req.m_identity);
+  done.m_header = rhdr.encode();
+  done.m_payload = support::message(packed);
+  done.m_frames = std::move(frames);
+  done.m_reply = true;
+  done.m_terminate = terminate;
+  done.m_release = !req.m_released.exchange(true);
+  done.m_pool = req.m_pool;
+  done.m_method = req.m_method;
+  done.m_key = std::move(req.m_key);
+  done.m_argsKey = std::move(req.m_argsKey);
+  done.m_failed = req.m_failed;
+  done.m_sum = sum;
+  complete(std::move(done));
+}
+
+void Server::replay(zmq::message_t &identity,
+                    const Header &hdr,
+                    const CachedReply &cached,
+                    std::vector<zmq::message_t> frames)
+{
+  // Only recompute the checksum if the client checks with a different mode
+  // than the call that filled the cache
+  Header rhdr;
+  rhdr.m_id = hdr.m_id;
+  rhdr.m_flags = cached.m_flags;
+  rhdr.m_integrity = hdr.m_integrity;
+  rhdr.m_checksum = rhdr.seal(
+      (cached.m_integrity == hdr.m_integrity)
+          ? cached.m_checksum
+          : support::checksum(hdr.m_integrity, cached.m_payload.data(),
+                              cached.m_payload.size()));
+  (void)m_frontend.send(identity, zmq::send_flags::sndmore);
+  (void)m_frontend.send(rhdr.encode(), zmq::send_flags::sndmore);
+  (void)m_frontend.send(
+      zmq::message_t(cached.m_payload.data(), cached.m_payload.size()),
+      frames.empty() ? zmq::send_flags::none : zmq::send_flags::sndmore);
+  for (std::size_t i = 0; i < frames.size(); ++i)
+  {
+    (void)m_frontend.send(frames[i], (i + 1 < frames.size())
+                                         ? zmq::send_flags::sndmore
+                                         : zmq::send_flags::none);
+  }
+}
+
+void Server::reject(zmq::message_t &identity,
+                    const Header &hdr,
+                    const Error &err)
+{
+  if (hdr.m_flags & Header::oneway)
+  {
+    return;
+  }
+
+  auto &sbuf = support::scratch();
+  msgpack::pack(sbuf, err);
+
+  Header rhdr;
+  rhdr.m_id = hdr.m_id;
+  rhdr.m_flags = Header::error;
+  rhdr.m_integrity = hdr.m_integrity;
+  rhdr.m_checksum = rhdr.checksum(sbuf.data(), sbuf.size());
+  (void)m_frontend.send(identity, zmq::send_flags::sndmore);
+  (void)m_frontend.send(rhdr.encode(), zmq::send_flags::sndmore);
+  (void)m_frontend.send(support::message(sbuf), zmq::send_flags::none);
+}
+
+bool Server::current(std::uint32_t method) const
+{
+  const auto index = method & 0xFFFFU;
+  return ((method >> 16) == fingerprint()) && (index >= 1U) &&
+         (index <= m_rpcs.size());
+}
+
+std::unordered_map<std::string, std::uint32_t> Server::describe(void) const
+{
+  std::unordered_map<std::string, std::uint32_t> table;
+  const auto fp = fingerprint() << 16;
+  for (auto &&[name, index] : m_methods)
+  {
+    // Keep clients calling 'terminate' by name so that it always stops the
+    // server, even when bound as an RPC
+    if (name != "terminate")
+    {
+      table.emplace(name, fp | index);
+    }
+  }
+
+  // Report the byte order raw values are packed in, so that clients on a
+  // host of the other order learn of it before sending any
+  table.emplace("zrpc.byteorder",
+                static_cast<std::uint8_t>(RawFormat::native));
+  return table;
+}
+
+std::uint32_t Server::fingerprint(void) const
+{
+  // Fold the table hash to 16 bits, keeping 0 free so that a method id is
+  // never 0
+  const auto fp = (m_tableHash ^ (m_tableHash >> 16)) & 0xFFFFU;
+  return fp ? fp : 1U;
+}
+
+void Server::addPool(const std::string &name,
+                     const uint32_t nThreads,
+                     const std::size_t maxConcurrent,
+                     const std::size_t maxQueued)
+{
+  if (m_poolIds.find(name) != m_poolIds.end())
+  {
+    throw std::runtime_error("Pool '" + name + "' has already been added.");
+  }
+
+  m_poolIds.emplace(name, static_cast<std::uint32_t>(m_pools.size()));
+  m_pools.emplace_back();
+  m_pools.back().m_threads = std::make_unique<ThreadPool>(nThreads);
+  m_pools.back().m_limit = (maxConcurrent > 0) ? maxConcurrent : nThreads;
+  m_pools.back().m_maxQueued = maxQueued;
+}
+
+std::uint32_t Server::lane(const Header &hdr, const zmq::message_t &msg) const
+{
+  // Batches mix RPCs, so they always run on the default lane, as do requests
+  // for unknown RPCs
+  std::uint32_t index = 0;
+  if (!(hdr.m_flags & Header::batch))
+  {
+    if (hdr.m_method != 0)
+    {
+      index = current(hdr.m_method) ? (hdr.m_method & 0xFFFFU) : 0U;
+    }
+    else
+    {
+      auto it = m_methods.find(peekName(msg));
+      index = (it != m_methods.end()) ? it->second : 0U;
+    }
+  }
+  return index;
+}
+
+void Server::schedule(Pool &pool)
+{
+  for (auto &&queue : pool.m_backlog)
+  {
+    while (!queue.empty() && (pool.m_inflight < pool.m_limit))
+    {
+      auto [req, hdr] = std::move(queue.front());
+      queue.pop_front();
+      --pool.m_queued;
+      ++pool.m_inflight;
+      pool.m_threads->submit(
+          [this, req, hdr]()
+          {
+            process(req, hdr);
+            release(*req);
+          });
+    }
+  }
+}
+
+void Server::release(Request &req)
+{
+  // A deferred request frees its slot for the next handler as soon as its own
+  // returns; it stays counted against the server and RPC limits until it
+  // replies
+  if (!req.m_released.exchange(true))
+  {
+    Completion done;
+    done.m_complete = false;
+    done.m_release = true;
+    done.m_pool = req.m_pool;
+    complete(std::move(done));
   }
 }
 
-void Server::reply(zmq::socket_t &sock,
-                   zmq::message_t &identity,
-                   std::unique_ptr<msgpack::object_handle> &res) const
+void Server::validate(const std::string &name, const BindOptions &opts) const
 {
-  // Reply with the identity of the message for the broker
-  zmq::message_t copied_id;
-  copied_id.copy(identity);
-  (void)sock.send(copied_id, zmq::send_flags::sndmore);
+  if (m_rpcs.size() >= 0xFFFFU)
+  {
+    throw std::runtime_error("Cannot bind '" + name +
+                             "': method table is full.");
+  }
 
-  // Pack the result into an object
-  auto sbuf = std::make_shared<msgpack::sbuffer>();
-  msgpack::pack(*sbuf, res->get());
-  (void)sock.send(zmq::const_buffer(sbuf->data(), sbuf->size()),
-                  zmq::send_flags::none);
-}
\ No newline at end of file
+  if (!opts.m_pool.empty() && (m_poolIds.find(opts.m_pool) == m_poolIds.end()))
+  {
+    throw std::runtime_error("Cannot bind '" + name + "': pool '" +
+                             opts.m_pool + "' has not been added.");
+  }
+
+  if (m_methods.find(name) != m_methods.end())
+  {
+    throw std::runtime_error("'" + name +
+                             "' has already been registered as an RPC.");
+  }
+}
+
+void Server::assign(const std::string &name, const BindOptions &opts)
+{
+  Lane l;
+  l.m_pool = opts.m_pool.empty() ? 0U : m_poolIds.at(opts.m_pool);
+  l.m_priority = opts.m_priority;
+  l.m_limit = opts.m_maxInflight;
+  if (opts.m_cache.m_maxEntries > 0)
+  {
+    l.m_cache =
+        std::make_unique<support::LruCache<std::string, CachedReply>>(
+            opts.m_cache);
+  }
+  l.m_coalesce = opts.m_coalesce;
+  m_lanes.emplace_back(std::move(l));
+  m_methods.emplace(name, static_cast<std::uint32_t>(m_rpcs.size()));
+  for (auto c : name)
+  {
+    m_tableHash = (m_tableHash ^ static_cast<std::uint8_t>(c)) * 16777619U;
+  }
+  m_tableHash *= 16777619U;
+}
+
+Responder::Responder(done_type done, const Context &context) :
+    m_state(std::make_shared<State>())
+{
+  m_state->m_done = std::move(done);
+  m_state->m_context = context;
+}
+
+const Context &Responder::context(void) const
+{
+  return m_state->m_context;
+}
+
+Responder::State::~State()
+{
+  // Never leave the client waiting on a reply that will not come
+  if (!m_replied && m_done)
+  {
+    Error err;
+    err.m_msg = "RPC completed without replying";
+    auto &sbuf = support::scratch();
+    msgpack::pack(sbuf, err);
+    m_done(sbuf, {}, true);
+  }
+}
+
+void Responder::reply(void)
+{
+  auto &sbuf = support::scratch();
+  msgpack::packer<msgpack::sbuffer>(sbuf).pack_nil();
+  finish(sbuf, {}, false);
+}
+
+void Responder::error(const std::string &msg)
+{
+  Error err;
+  err.m_msg = msg;
+  auto &sbuf = support::scratch();
+  msgpack::pack(sbuf, err);
+  finish(sbuf, {}, true);
+}
+
+void Responder::finish(msgpack::sbuffer &packed,
+                       std::vector<zmq::message_t> frames,
+                       bool failed)
+{
+  // Only the first reply is sent
+  if (!m_state->m_replied.exchange(true))
+  {
+    m_state->m_done(packed, std::move(frames), failed);
+  }
+}
+
+CancellationToken::CancellationToken(void) :
+    m_cancelled(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+bool CancellationToken::cancelled(void) const
+{
+  return m_cancelled->load(std::memory_order_relaxed);
+}
+
+void CancellationToken::cancel(void)
+{
+  m_cancelled->store(true, std::memory_order_relaxed);
+}
+
+Context::Context(clock_type::time_point deadline, CancellationToken token) :
+    m_deadline(deadline),
+    m_token(std::move(token))
+{
+}
+
+Context::clock_type::time_point Context::deadline(void) const
+{
+  return m_deadline;
+}
+
+bool Context::expired(void) const
+{
+  return clock_type::now() >= m_deadline;
+}
+
+std::chrono::milliseconds Context::remaining(void) const
+{
+  if (m_deadline == clock_type::time_point::max())
+  {
+    return std::chrono::milliseconds::max();
+  }
+
+  const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      m_deadline - clock_type::now());
+  return std::max(left, std::chrono::milliseconds(0));
+}
+
+const CancellationToken &Context::token(void) const
+{
+  return m_token;
+}
+
+bool Context::cancelled(void) const
+{
+  return m_token.cancelled();
+}
+
+const Context &Context::current(void)
+{
+  static const Context none;
+  return currentContext ? *currentContext : none;
+}
@@ -0,0 +1,152 @@
+/*
+ * @file   zRPCThreadPool.cpp
+ * @author Jonathan Haws
+ * @date   16-Oct-2026 3:41:08 pm
+ *
+ * @brief 0MQ-based RPC client/server library with MessagePack support
+ *
+ * @copyright Jonathan Haws -- 2026
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "zRPC.hpp"
+
+#include <iostream>
+
+using namespace zRPC;
+
+namespace
+{
+/**
+ * @brief Pool owning the calling thread, if any
+ */
+thread_local ThreadPool *t_pool = nullptr;
+
+/**
+ * @brief Index of the queue owned by the calling thread
+ */
+thread_local std::size_t t_index = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(const uint32_t nThreads)
+{
+  const std::size_t n = (nThreads > 0) ? nThreads : 1U;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    m_queues.emplace_back(std::make_unique<Queue>());
+  }
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    m_th.emplace_back(std::thread([this, i]() { worker(i); }));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_running = false;
+  }
+  m_cv.notify_all();
+
+  // Loop over all pool threads and join them
+  for (auto &t : m_th)
+  {
+    if (t.joinable())
+    {
+      t.join();
+    }
+  }
+}
+
+void ThreadPool::submit(job_type job)
+{
+  // Keep work spawned by a job on the same thread, where its data is likely
+  // still in cache
+  const auto index =
+      (t_pool == this) ? t_index : (m_next++ % m_queues.size());
+  {
+    std::lock_guard<std::mutex> lock(m_queues[index]->m_mtx);
+    m_queues[index]->m_jobs.emplace_back(std::move(job));
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    ++m_queued;
+  }
+  m_cv.notify_one();
+}
+
+bool ThreadPool::take(const std::size_t index, job_type &job)
+{
+  // Oldest job from our own queue first, then the newest from the others
+  for (std::size_t i = 0; i < m_queues.size(); ++i)
+  {
+    auto &queue = *m_queues[(index + i) % m_queues.size()];
+    std::lock_guard<std::mutex> lock(queue.m_mtx);
+    if (!queue.m_jobs.empty())
+    {
+      if (i == 0)
+      {
+        job = std::move(queue.m_jobs.front());
+        queue.m_jobs.pop_front();
+      }
+      else
+      {
+        job = std::move(queue.m_jobs.back());
+        queue.m_jobs.pop_back();
+      }
+      --m_queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::worker(const std::size_t index)
+{
+  t_pool = this;
+  t_index = index;
+
+  while (true)
+  {
+    job_type job;
+    if (take(index, job))
+    {
+      try
+      {
+        job();
+      }
+      catch (const std::exception &e)
+      {
+        std::cerr << " !! Thread Pool Job Error: " << e.what() << std::endl;
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cv.wait(lock, [this]() { return !m_running || (m_queued > 0); });
+    if (!m_running && (m_queued == 0))
+    {
+      // Only exit once all queued jobs have run
+      break;
+    }
+  }
+
+  t_pool = nullptr;
+}
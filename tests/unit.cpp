@@ -25,10 +25,69 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include "zRPC.hpp"
 
+// Set by the 'spin' RPC once it sees whether its caller cancelled it
+std::promise<bool> spinCancelled;
+
+// Set by the client to let the 'one' RPC return
+std::promise<void> oneReleased;
+
+// Set by the 'hold' RPC once it starts, and once its caller cancels it
+std::promise<void> holdStarted;
+std::promise<void> holdCancelled;
+
+// Number of times the cached 'square' RPC has actually run
+std::atomic<int> squareCalls{0};
+
+// Number of times the coalesced 'cube' RPC has actually run
+std::atomic<int> cubeCalls{0};
+
+// Set by the 'gate' RPC once it occupies its pool, and by the client to let
+// it return
+std::promise<void> gateEntered;
+std::promise<void> gateOpened;
+
+// Order in which the 'routine' and 'urgent' RPCs ran
+std::atomic<int> serialOrder{0};
+
+// Largest and latest number of calls handed to the batched 'add' RPC at once
+std::atomic<std::size_t> largestBatch{0};
+std::atomic<std::size_t> lastBatch{0};
+
+// Fixed-layout value sent as a copy of its bytes
+struct Vec3
+{
+  double x;
+  double y;
+  double z;
+};
+
+template <>
+struct zRPC::Codec<Vec3> : zRPC::RawCodec<Vec3>
+{
+};
+
+template <>
+struct zRPC::Codec<std::vector<float>> : zRPC::RawCodec<std::vector<float>>
+{
+};
+
+// Typed interface to some of the RPCs bound by the server
+template <typename B>
+struct Tools : B
+{
+  using B::B;
+  ZRPC_METHOD(echo, std::string(std::string))
+  ZRPC_METHOD(twice, double(double))
+  ZRPC_METHOD(missing, void())
+  ZRPC_METHOD(l1, int(int, int))
+  ZRPC_METHOD(snooze, void(int))
+};
+
 void l1(zRPC::Client &client)
 {
   try
@@ -63,6 +122,18 @@ void l2(zRPC::Client &client)
   }
 }
 
+zRPC::Task<int> fanout(zRPC::Client &client, zRPC::Executor &ex)
+{
+  co_await ex.schedule();
+
+  // Issue both calls at once and resume on the executor when both are done
+  std::vector<zRPC::Task<int>> calls;
+  calls.emplace_back(client.co_call<int>("l1", 1, 2));
+  calls.emplace_back(client.co_call<int>("co", 4));
+  auto res = co_await zRPC::when_all(std::move(calls));
+  co_return res[0] + res[1];
+}
+
 void client(void)
 {
   std::cout << "Starting zRPC client!" << std::endl;
@@ -73,6 +144,252 @@ void client(void)
   l1t.join();
   l2t.join();
 
+  // Pooled connections carry sequential and concurrent calls to the right
+  // callers
+  for (int i = 0; i < 50; i++)
+  {
+    assert(client.call("twice", static_cast<double>(i)).get().as<double>() ==
+           2.0 * i);
+  }
+  std::vector<std::thread> callers;
+  for (int t = 0; t < 8; t++)
+  {
+    callers.emplace_back(
+        [&client, t]()
+        {
+          for (int i = 0; i < 25; i++)
+          {
+            const auto x = static_cast<double>((t * 100) + i);
+            assert(client.call("twice", x).get().as<double>() == 2.0 * x);
+          }
+        });
+  }
+  for (auto &&c : callers)
+  {
+    c.join();
+  }
+
+  // Keep several requests in flight over the shared asynchronous connection
+  std::vector<std::future<msgpack::object_handle>> futs;
+  for (int i = 0; i < 4; i++)
+  {
+    futs.emplace_back(client.async_call("l1", 3, i));
+  }
+  for (int i = 0; i < 4; i++)
+  {
+    auto ares = futs[static_cast<std::size_t>(i)].get();
+    std::cout << "async l1 result = " << ares.get().as<int>() << std::endl;
+    assert(ares.get().as<int>() == (3 + i));
+  }
+
+  // A callback that throws leaves the I/O thread serving later calls
+  std::promise<void> thrown;
+  client.async_call(
+      [&thrown](msgpack::object_handle &)
+      {
+        thrown.set_value();
+        throw std::runtime_error("Callback failed");
+      },
+      "ping");
+  thrown.get_future().wait();
+  assert(client.async_call("ping").get().get().as<int>() == 1);
+
+  // Run an RPC conversation as a coroutine on a small executor
+  zRPC::Executor ex(2);
+  auto cres = zRPC::sync_wait(fanout(client, ex));
+  std::cout << "coroutine fan-out result = " << cres << std::endl;
+  assert(cres == (1 + 2) + (4 * 3));
+
+  // Calls now carry method ids rather than names, including within batches
+  assert(client.describe(1000));
+
+  // Send several calls to the server in a single request
+  auto bres = client.batch().add("l1", 1, 1).add("co", 2).add("l3").call();
+  assert(bres.size() == 3);
+  assert(bres[0].get().as<int>() == 2);
+  assert(bres[1].get().as<int>() == 6);
+  assert(bres[2].get().as<zRPC::Error>().m_msg == "'l3' RPC not found!");
+
+  // A second client checking its traffic with xxHash32 is answered in kind
+  zRPC::Client fast("TEST-FAST", "tcp://localhost:12345",
+                    zRPC::Integrity::xxhash32);
+  assert(fast.call("l1", 2, 5).get().as<int>() == 7);
+
+  // A quick call from one client is answered while a slow call from another
+  // is still running, rather than queueing behind it
+  auto slow = client.async_call("snooze", 2000);
+  assert(fast.call("twice", 1.5).get().as<double>() == 3.0);
+  assert(slow.wait_for(std::chrono::seconds(0)) ==
+         std::future_status::timeout);
+  slow.get();
+  assert(zRPC::support::checksum(zRPC::Integrity::crc32c, "123456789", 9) ==
+         0xE3069283U);
+
+  // Control RPCs run on their own pool, ahead of everything else queued there
+  assert(client.call("ping").get().as<int>() == 1);
+
+  // While low-priority work fills a pool, another pool keeps serving, and a
+  // high-priority call overtakes the low-priority ones queued before it; the
+  // calls share a connection, so both are queued once 'ping' is answered
+  auto gate = client.async_call("gate");
+  gateEntered.get_future().wait();
+  auto routine = client.async_call("routine");
+  auto urgent = client.async_call("urgent");
+  assert(client.async_call("ping").get().get().as<int>() == 1);
+  gateOpened.set_value();
+  assert(urgent.get().get().as<int>() == 1);
+  assert(routine.get().get().as<int>() == 2);
+  assert(gate.get().get().as<int>() == 0);
+
+  // Deferred handlers reply from another thread or through a future
+  assert(client.call("later", 4).get().as<int>() == 5);
+  assert(client.call("fut", 4).get().as<int>() == 8);
+
+  // A call beyond the RPC's in-flight limit is shed rather than queued; both
+  // calls share a connection, so the first is in flight when the second lands
+  auto first = client.async_call("one");
+  auto shed = client.async_call("one").get();
+  assert(shed.get().as<zRPC::Error>().m_code == zRPC::Error::overloaded);
+  oneReleased.set_value();
+  assert(first.get().get().as<int>() == 1);
+
+  // Handlers see how long the caller is still waiting for them
+  auto left = client.call(1000, "budget").get().as<std::int64_t>();
+  assert((left > 0) && (left <= 1000));
+
+  // Abandoning a call cancels the handler still running it
+  auto spun = spinCancelled.get_future();
+  assert(client.call(500, "spin").get().is_nil());
+  assert(spun.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+  assert(spun.get());
+
+  // Cancelling an asynchronous call stops the handler running it
+  std::promise<bool> unanswered;
+  const auto held = client.async_call(
+      [&unanswered](msgpack::object_handle &res)
+      { unanswered.set_value(!res.zone()); },
+      "hold");
+  assert(holdStarted.get_future().wait_for(std::chrono::seconds(5)) ==
+         std::future_status::ready);
+  assert(client.cancel(held));
+  assert(!client.cancel(held));
+  assert(unanswered.get_future().get());
+  assert(holdCancelled.get_future().wait_for(std::chrono::seconds(5)) ==
+         std::future_status::ready);
+
+  // Repeated calls to a pure RPC are answered from the server's cache
+  assert(client.call("square", 9).get().as<int>() == 81);
+  assert(client.call("square", 9).get().as<int>() == 81);
+  assert(client.call("square", 3).get().as<int>() == 9);
+  assert(squareCalls == 2);
+
+  // Identical calls made while one is running share its reply
+  std::vector<std::future<msgpack::object_handle>> cubes;
+  for (int i = 0; i < 3; i++)
+  {
+    cubes.emplace_back(client.async_call("cube", 2));
+  }
+  for (auto &&c : cubes)
+  {
+    assert(c.get().get().as<int>() == 8);
+  }
+  assert(cubeCalls == 1);
+
+  // Results of idempotent RPCs are cached by the client until invalidated
+  client.cache("cube", {16, 0, std::chrono::seconds(10)});
+  assert(client.call("cube", 3).get().as<int>() == 27);
+  assert(client.call("cube", 3).get().as<int>() == 27);
+  assert(cubeCalls == 2);
+  client.invalidate("cube");
+  assert(client.call("cube", 3).get().as<int>() == 27);
+  assert(cubeCalls == 3);
+
+  // Calls to a batched RPC arriving together are handled in one go
+  std::vector<std::future<msgpack::object_handle>> adds;
+  for (int i = 0; i < 4; i++)
+  {
+    adds.emplace_back(client.async_call("add", i, 10));
+  }
+  for (int i = 0; i < 4; i++)
+  {
+    auto ares = adds[static_cast<std::size_t>(i)].get();
+    assert(ares.get().as<int>() == (i + 10));
+  }
+  assert(largestBatch > 1);
+
+  // Calls abandoned while waiting for their batch are left out of it
+  assert(client.call(10, "add", 1, 2).get().is_nil());
+  assert(client.async_call("add", 3, 4).get().get().as<int>() == 7);
+  assert(lastBatch == 1);
+
+  // Replies packed into a reused buffer carry nothing over from earlier ones
+  const std::string big(100000, 'x');
+  assert(client.call("echo", big).get().as<std::string>() == big);
+  assert(client.call("echo", std::string("y")).get().as<std::string>() == "y");
+  const std::string word("zero-copy");
+  auto echoed = client.call("echo", word);
+  assert(echoed.get().as<std::string_view>() == word);
+
+  // Blobs travel as frames of their own, in both directions
+  std::vector<std::uint8_t> tile(65536);
+  for (std::size_t i = 0; i < tile.size(); ++i)
+  {
+    tile[i] = static_cast<std::uint8_t>(i * 7);
+  }
+  auto flipped =
+      client.call("flip", zRPC::Blob(std::vector<std::uint8_t>(tile)));
+  auto blob = flipped.get().as<zRPC::Blob>();
+  assert(blob.size() == tile.size());
+  assert(std::equal(tile.rbegin(), tile.rend(), blob.data()));
+
+  // View parameters point into the request instead of copying out of it
+  assert(client.call("measure", std::string("abcd"), std::vector<int>{1, 2, 3},
+                     std::vector<std::uint8_t>{9, 9})
+             .get()
+             .as<std::size_t>() == 4 + 6 + 2);
+
+  // Raw values are copied in bulk and can be viewed as spans by the server
+  auto scaled =
+      client.call("scale", Vec3{1, 2, 3}, std::vector<float>{1.5f, 0.5f});
+  assert(zRPC::RawFormat::holds(scaled.get()));
+  auto v = zRPC::decode<Vec3>(scaled.get());
+  assert((v.x == 2.0) && (v.y == 4.0) && (v.z == 6.0));
+
+  // Typed calls convert their arguments and results to the declared types
+  Tools<zRPC::Stub> tools(client);
+  assert(tools.twice(21) == 42.0);
+  assert(tools.echo("typed") == "typed");
+  bool threw = false;
+  try
+  {
+    tools.missing();
+  }
+  catch (const std::runtime_error &)
+  {
+    threw = true;
+  }
+  assert(threw);
+
+  // Typed calls not answered in time throw, whether or not they return a value
+  Tools<zRPC::Stub> hasty(client, 100);
+  for (int i = 0; i < 2; ++i)
+  {
+    threw = false;
+    try
+    {
+      (i == 0) ? (void)hasty.l1(1, 2) : hasty.snooze(1000);
+    }
+    catch (const std::runtime_error &e)
+    {
+      threw = (std::string(e.what()).find("timed out") != std::string::npos);
+    }
+    assert(threw);
+  }
+
+  // One-way calls return immediately and get no reply
+  client.notify("l1", 1, 2);
+  client.notify("l3");
+
   auto res = client.call("l3");
   try
   {
@@ -107,11 +424,212 @@ void server(void)
              sleep(2);
              return a * b;
            });
+  srv.bind("co", [](int a) -> zRPC::Task<int> { co_return a * 3; });
+  srv.addPool("control", 1);
+  srv.bind("ping", []() { return 1; }, {"control", zRPC::Priority::high});
+  srv.addPool("serial", 1);
+  srv.bind("gate",
+           []()
+           {
+             gateEntered.set_value();
+             gateOpened.get_future().wait();
+             return 0;
+           },
+           {"serial", zRPC::Priority::low});
+  srv.bind("routine", []() { return ++serialOrder; },
+           {"serial", zRPC::Priority::low});
+  srv.bind("urgent", []() { return ++serialOrder; },
+           {"serial", zRPC::Priority::high});
+  srv.bind("later",
+           [](zRPC::Responder res, int a)
+           { std::thread([res, a]() mutable { res.reply(a + 1); }).detach(); });
+  srv.bind("fut",
+           [](int a)
+           { return std::async(std::launch::async, [a]() { return a * 2; }); });
+  srv.bind("budget",
+           []()
+           {
+             return static_cast<std::int64_t>(
+                 zRPC::Context::current().remaining().count());
+           });
+  srv.bind("spin",
+           []()
+           {
+             auto token = zRPC::Context::current().token();
+             for (int i = 0; (i < 10000) && !token.cancelled(); ++i)
+             {
+               std::this_thread::sleep_for(std::chrono::milliseconds(1));
+             }
+             spinCancelled.set_value(token.cancelled());
+             return 0;
+           });
+  srv.bind("hold",
+           []()
+           {
+             auto token = zRPC::Context::current().token();
+             holdStarted.set_value();
+             for (int i = 0; (i < 10000) && !token.cancelled(); ++i)
+             {
+               std::this_thread::sleep_for(std::chrono::milliseconds(1));
+             }
+             if (token.cancelled())
+             {
+               holdCancelled.set_value();
+             }
+             return 0;
+           });
+  zRPC::BindOptions pure;
+  pure.m_cache.m_maxEntries = 64;
+  pure.m_cache.m_ttl = std::chrono::seconds(10);
+  srv.bind("square",
+           [](int a)
+           {
+             ++squareCalls;
+             return a * a;
+           },
+           pure);
+  zRPC::BindOptions herd;
+  herd.m_coalesce = true;
+  srv.bind("cube",
+           [](int a)
+           {
+             ++cubeCalls;
+             std::this_thread::sleep_for(std::chrono::milliseconds(500));
+             return a * a * a;
+           },
+           herd);
+  srv.bind_batch(
+      "add",
+      [](std::vector<std::tuple<int, int>> calls)
+      {
+        largestBatch = std::max(largestBatch.load(), calls.size());
+        lastBatch = calls.size();
+        std::vector<int> sums;
+        for (auto &&[a, b] : calls)
+        {
+          sums.push_back(a + b);
+        }
+        return sums;
+      },
+      4, std::chrono::milliseconds(50));
+  srv.bind("echo", [](std::string s) { return s; });
+  Tools<zRPC::Binder> tools(srv);
+  tools.twice([](double a) { return a * 2; });
+  tools.snooze([](int ms)
+               { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); });
+  srv.bind("measure",
+           [](std::string_view s, std::span<const int> v,
+              std::span<const std::uint8_t> bytes)
+           {
+             std::size_t total = s.size() + bytes.size();
+             for (auto i : v)
+             {
+               total += static_cast<std::size_t>(i);
+             }
+             return total;
+           });
+  srv.bind("scale",
+           [](Vec3 v, std::span<const float> weights)
+           {
+             double s = 0;
+             for (auto w : weights)
+             {
+               s += w;
+             }
+             return Vec3{v.x * s, v.y * s, v.z * s};
+           });
+  srv.bind("flip",
+           [](zRPC::Blob b)
+           {
+             std::vector<std::uint8_t> out(b.data(), b.data() + b.size());
+             std::reverse(out.begin(), out.end());
+             return zRPC::Blob(std::move(out));
+           });
+  zRPC::BindOptions single;
+  single.m_maxInflight = 1;
+  srv.bind("one",
+           []()
+           {
+             oneReleased.get_future().wait();
+             return 1;
+           },
+           single);
   srv.start();
 
   std::cout << " EXITING SERVER THREAD!" << std::endl;
 }
 
+void restart(void)
+{
+  const std::string uri = "tcp://localhost:12346";
+  zRPC::Client blocking("restart-blocking", uri);
+  zRPC::Client async("restart-async", uri);
+  zRPC::Client batched("restart-batched", uri);
+
+  // Describe a first server, then replace it with one numbering its RPCs
+  // differently, leaving every client with stale method ids
+  {
+    zRPC::Server first("tcp://*:12346", 2);
+    first.bind("double", [](int x) { return 2 * x; });
+    auto th = std::thread([&first]() { first.start(); });
+    assert(blocking.call(5000, "double", 1).get().as<int>() == 2);
+    assert(async.describe(5000));
+    assert(batched.describe(5000));
+    first.stop();
+    th.join();
+  }
+
+  std::promise<void> rung;
+  zRPC::Server second("tcp://*:12346", 2);
+  second.bind("ring", [&rung]() { rung.set_value(); });
+  second.bind("double", [](int x) { return 2 * x; });
+  auto th = std::thread([&second]() { second.start(); });
+
+  // Calls sent with stale ids are sent again by name
+  assert(blocking.call(5000, "double", 5).get().as<int>() == 10);
+  assert(async.async_call("double", 6).get().get().as<int>() == 12);
+  auto res = batched.batch().add("double", 3).add("double", 4).call(5000);
+  assert(res.size() == 2);
+  assert(res[0].get().as<int>() == 6);
+  assert(res[1].get().as<int>() == 8);
+
+  // One-way calls go by name, so they reach the new server too
+  blocking.notify("ring");
+  assert(rung.get_future().wait_for(std::chrono::seconds(5)) ==
+         std::future_status::ready);
+
+  second.stop();
+  th.join();
+}
+
+void overload(void)
+{
+  const std::string uri = "tcp://localhost:12347";
+  zRPC::Client client("overload", uri);
+
+  // Requests beyond the server's pending limit are rejected rather than
+  // queued behind the one already held by its only worker
+  std::promise<void> released;
+  auto gate = released.get_future().share();
+  zRPC::Server srv("tcp://*:12347", 1, 1);
+  srv.bind("wait",
+           [gate]()
+           {
+             gate.wait();
+             return 1;
+           });
+  auto th = std::thread([&srv]() { srv.start(); });
+
+  auto held = client.async_call("wait");
+  auto shed = client.async_call("wait").get();
+  assert(shed.get().as<zRPC::Error>().m_code == zRPC::Error::overloaded);
+  released.set_value();
+  assert(held.get().get().as<int>() == 1);
+
+  srv.stop();
+  th.join();
+}
+
 void pub(void)
 {
   using namespace std::chrono_literals;
@@ -178,6 +696,12 @@ int main(void)
   cl.join();
   srv.join();
 
+  // Method ids across a server restart
+  restart();
+
+  // Requests beyond the pending limit of the server
+  overload();
+
   // Pub/Sub test
   auto pth = std::thread(pub);
   auto sth = std::thread(sub);